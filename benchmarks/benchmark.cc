@@ -0,0 +1,293 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "mm/sqlite/sqlite.hh"
+#include <map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <functional>
+
+namespace
+{
+using mm::sqlite::row;
+using mm::sqlite::column;
+using mm::sqlite::database;
+using mm::sqlite::statement;
+using mm::sqlite::batch_inserter;
+using mm::sqlite::fulltext_index;
+
+
+void measure(std::string const&           name,
+             long const&                  operations,
+             std::function<void()> const& function)
+{
+    auto const started = std::chrono::steady_clock::now();
+    function();
+    double const seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - started)
+                               .count();
+
+    std::printf("%-24s %10ld ops %10.3f s %14.0f ops/s\n",
+                name.c_str(),
+                operations,
+                seconds,
+                seconds > 0 ? static_cast<double>(operations) / seconds : 0.0);
+}
+
+
+// pronounceable words built from syllables, word(i) is unique per i
+std::string word(long value)
+{
+    static char const* const syllables[] = {"ka", "lo", "mi", "ne", "ru",
+                                            "sa", "te", "vo", "zi", "po",
+                                            "da", "fe", "gu", "hi", "jo",
+                                            "bu", "ce", "wa", "xo", "ye"};
+
+    std::string result {};
+    do
+    {
+        result += syllables[value % 20];
+        value /= 20;
+    } while (value > 0);
+    return result;
+}
+
+
+void run_fulltext(database& db, long const& documents)
+{
+    long const vocabulary = 20000;
+    long const words      = 12;
+
+    db.execute("CREATE TABLE document (id INTEGER PRIMARY KEY, body TEXT)");
+
+    measure("fulltext load",
+            documents,
+            [&]()
+            {
+                batch_inserter inserter {db, "document", {"id", "body"}};
+
+                unsigned long long seed = 88172645463325252ULL;
+
+                std::vector<row> batch {};
+                for (long i = 0; i < documents; ++i)
+                {
+                    std::string body {};
+                    body.reserve(static_cast<std::size_t>(words) * 8);
+                    for (long w = 0; w < words; ++w)
+                    {
+                        seed ^= seed << 13;
+                        seed ^= seed >> 7;
+                        seed ^= seed << 17;
+                        if (w)
+                            body.append(1, ' ');
+                        body.append(word(static_cast<long>(
+                            seed % static_cast<unsigned>(vocabulary))));
+                    }
+
+                    row r {"id", column {static_cast<int>(i)}};
+                    r.append("body", column {body});
+                    batch.push_back(std::move(r));
+
+                    if (batch.size() == 10000 || i + 1 == documents)
+                    {
+                        inserter.insert(batch);
+                        batch.clear();
+                    }
+                }
+            });
+
+    fulltext_index index {db, "document", {"body"}};
+
+    measure("fulltext index",
+            documents,
+            [&]()
+            {
+                index.create();
+                index.rebuild();
+            });
+
+    long const like_queries  = 10;
+    long const match_queries = 1000;
+
+    measure("like search",
+            like_queries,
+            [&]()
+            {
+                std::string pattern {};
+                for (long i = 0; i < like_queries; ++i)
+                {
+                    pattern.assign(1, '%');
+                    pattern.append(word(i * 997 + 400));
+                    pattern.append(1, '%');
+                    db.execute("SELECT count(*) AS c FROM document "
+                               "WHERE body LIKE :pattern",
+                               row {"pattern", column {pattern, "pattern"}});
+                }
+            });
+
+    measure("match search",
+            match_queries,
+            [&]()
+            {
+                for (long i = 0; i < match_queries; ++i)
+                    index.count(fulltext_index::term(word(i * 997 + 400)));
+            });
+
+    measure("ranked match top 10",
+            match_queries,
+            [&]()
+            {
+                for (long i = 0; i < match_queries; ++i)
+                    index.search_rows(
+                        fulltext_index::term(word(i * 997 + 400)), 10);
+            });
+}
+
+
+void run(std::string const& path, long const& rows, long const& documents)
+{
+    std::remove(path.c_str());
+
+    database db {path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+
+    db.execute("PRAGMA journal_mode = WAL");
+    db.execute("CREATE TABLE item ("
+               "id INTEGER PRIMARY KEY, name TEXT, price REAL, stock INTEGER)");
+
+    measure("insert",
+            rows,
+            [&]()
+            {
+                db.execute("BEGIN");
+                for (long i = 0; i < rows; ++i)
+                {
+                    row r {};
+                    r.append("id", column {static_cast<int>(i), "id"});
+                    r.append("name",
+                             column {"item " + std::to_string(i), "name"});
+                    r.append("price",
+                             column {static_cast<double>(i % 1000) / 10.0,
+                                     "price"});
+                    r.append("stock",
+                             column {static_cast<int>(i % 97), "stock"});
+                    db.execute(
+                        "INSERT INTO item VALUES (:id, :name, :price, :stock)",
+                        r);
+                }
+                db.execute("COMMIT");
+            });
+
+    long const lookups = rows < 100000 ? rows : 100000;
+
+    auto const point_select = [&]()
+    {
+        for (long i = 0; i < lookups; ++i)
+        {
+            int const id = static_cast<int>((i * 7919) % 1000);
+            db.execute("SELECT name, price FROM item WHERE id = :id",
+                       row {"id", column {id, "id"}});
+        }
+    };
+
+    measure("point select", lookups, point_select);
+
+    db.cache(16 * 1024 * 1024);
+    measure("point select cached", lookups, point_select);
+    db.cache(0);
+
+    measure("range scan",
+            100,
+            [&]()
+            {
+                for (int i = 0; i < 100; ++i)
+                    db.execute("SELECT id, price FROM item "
+                               "WHERE id BETWEEN :low AND :high",
+                               row {std::map<std::string, column> {
+                                   {"low", column {i * 100, "low"}},
+                                   {"high", column {i * 100 + 999, "high"}}}});
+            });
+
+    db.create_function(
+        "discount",
+        [](double price, sqlite3_int64 stock)
+        { return stock > 50 ? price * 0.9 : price; },
+        SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS);
+
+    measure("aggregate function",
+            rows,
+            [&]()
+            {
+                db.execute("SELECT sum(discount(price, stock)) AS total, "
+                           "count(*) AS items FROM item GROUP BY stock % 10");
+            });
+
+    measure("update",
+            rows / 10,
+            [&]()
+            {
+                db.execute("BEGIN");
+                for (long i = 0; i < rows / 10; ++i)
+                    db.execute(
+                        "UPDATE item SET stock = stock + 1 WHERE id = :id",
+                        row {"id", column {static_cast<int>(i), "id"}});
+                db.execute("COMMIT");
+            });
+
+    if (documents > 0)
+        run_fulltext(db, documents);
+
+    db.close();
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    std::string const path = argc > 1 ? argv[1] : "mmsqlite_benchmark.db";
+    long const        rows = argc > 2 ? std::atol(argv[2]) : 200000;
+
+    // documents of the full-text benchmark, 0 skips it
+    long const documents = argc > 3 ? std::atol(argv[3]) : 1000000;
+
+    if (rows <= 0 || documents < 0)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " [database-path] [rows] [documents]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        run(path, rows, documents);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "| Error :: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "async_database.hh"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <utility>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+row_stream::next_operation::next_operation(row_stream& stream)
+    : m_stream {&stream}
+{
+}
+
+
+bool row_stream::next_operation::await_ready() const noexcept
+{
+    auto const& current = *m_stream->m_state;
+    return !current.rows.empty() || current.done;
+}
+
+
+void row_stream::next_operation::await_suspend(std::coroutine_handle<> handle)
+{
+    async_database* const owner   = m_stream->m_owner;
+    auto const            current = m_stream->m_state;
+
+    owner->dispatch(m_stream->m_connection,
+                    [owner, current, handle](database& db)
+                    {
+                        current->fetch(db);
+                        owner->resume(handle);
+                    });
+}
+
+
+std::optional<row> row_stream::next_operation::await_resume()
+{
+    auto& current = *m_stream->m_state;
+
+    if (!current.rows.empty())
+    {
+        row result = std::move(current.rows.front());
+        current.rows.pop_front();
+        return result;
+    }
+
+    if (current.error)
+        std::rethrow_exception(std::exchange(current.error, nullptr));
+
+    return std::nullopt;
+}
+
+
+row_stream::~row_stream() { release(); }
+
+
+row_stream::row_stream(row_stream&& other) noexcept
+    : m_owner {other.m_owner}
+    , m_connection {other.m_connection}
+    , m_state {std::move(other.m_state)}
+{
+}
+
+
+row_stream& row_stream::operator=(row_stream&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_owner      = other.m_owner;
+        m_connection = other.m_connection;
+        m_state      = std::move(other.m_state);
+    }
+    return *this;
+}
+
+
+row_stream::next_operation row_stream::next()
+{
+    if (!m_state)
+        throw std::runtime_error {"Invalid row stream."};
+    return next_operation {*this};
+}
+
+
+row_stream::row_stream(async_database&    owner,
+                       std::size_t const& connection,
+                       std::string const& sql_,
+                       row const&         row_,
+                       std::size_t const& batch)
+    : m_owner {&owner}
+    , m_connection {connection}
+    , m_state {std::make_shared<state>()}
+{
+    if (!batch)
+        throw std::runtime_error {"Invalid row stream batch size."};
+    m_state->sql        = sql_;
+    m_state->parameters = row_;
+    m_state->batch      = batch;
+}
+
+
+void row_stream::release()
+{
+    if (!m_state || !m_state->stmt)
+        return;
+
+    // the statement belongs to the connection thread
+    auto const current = std::move(m_state);
+
+    try
+    {
+        m_owner->dispatch(m_connection,
+                          [current](database&) { current->stmt.reset(); });
+    }
+    catch (...)
+    {
+    }
+}
+
+
+void row_stream::state::fetch(database& db)
+{
+    try
+    {
+        if (!stmt)
+            stmt.emplace(db.prepare(sql, parameters));
+
+        for (std::size_t i = 0; i < batch; ++i)
+        {
+            stmt->step();
+            if (!stmt->has_row())
+            {
+                done = true;
+                break;
+            }
+            rows.push_back(stmt->get_row());
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+        done  = true;
+    }
+
+    if (done)
+        stmt.reset();
+}
+
+
+async_database::~async_database()
+{
+    // queued completions resume through the executor, drain the threads
+    // before it and their databases are destroyed
+    for (auto& v : m_connections)
+        v->thread.stop();
+}
+
+
+async_database::async_database(std::string const& path,
+                               int const&         flags,
+                               std::size_t const& connections,
+                               executor const&    executor_)
+    : m_executor {executor_}
+{
+    if (!connections)
+        throw std::runtime_error {"Invalid connection count."};
+
+    for (std::size_t i = 0; i < connections; ++i)
+    {
+        auto conn = std::make_unique<connection>();
+        conn->db.open(path, flags);
+        m_connections.push_back(std::move(conn));
+    }
+}
+
+
+std::size_t async_database::size() const { return m_connections.size(); }
+
+
+std::size_t async_database::pending() const
+{
+    std::size_t total = 0;
+    for (auto const& conn : m_connections)
+        total += conn->thread.pending();
+    return total;
+}
+
+
+async_operation<std::vector<row>>
+async_database::execute(std::string const& sql_, row const& row_)
+{
+    return {*this,
+            [sql_, row_](database& db) { return db.execute(sql_, row_); }};
+}
+
+
+row_stream async_database::stream(std::string const& sql_,
+                                  row const&         row_,
+                                  std::size_t const& batch)
+{
+    return {*this, select(), sql_, row_, batch};
+}
+
+
+std::size_t async_database::select() const
+{
+    // the least loaded connection, ties are rotated
+    std::size_t const count = m_connections.size();
+    std::size_t const start = m_next.fetch_add(1, std::memory_order_relaxed);
+
+    std::size_t best         = start % count;
+    std::size_t best_pending = m_connections[best]->thread.pending();
+
+    for (std::size_t i = 1; i < count && best_pending > 0; ++i)
+    {
+        std::size_t const index   = (start + i) % count;
+        std::size_t const pending = m_connections[index]->thread.pending();
+        if (pending < best_pending)
+        {
+            best         = index;
+            best_pending = pending;
+        }
+    }
+
+    return best;
+}
+
+
+void async_database::dispatch(std::size_t const&                    index,
+                              std::function<void(database&)> const& task)
+{
+    database& db = m_connections[index]->db;
+    m_connections[index]->thread.submit([&db, task]() { task(db); });
+}
+
+
+void async_database::resume(std::coroutine_handle<> const& handle) const
+{
+    if (m_executor)
+        m_executor(handle);
+    else
+        handle.resume();
+}
+} // namespace sqlite
+} // namespace mm
+
+#endif
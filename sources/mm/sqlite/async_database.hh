@@ -0,0 +1,263 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include "row.hh"
+#include "worker.hh"
+#include "database.hh"
+#include "statement.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+class async_database;
+
+
+// awaitable running a function on one of the pool connections
+template <typename Result>
+class async_operation
+{
+public:
+    using function_type = std::function<Result(database&)>;
+
+    async_operation() = delete;
+    ~async_operation() = default;
+
+    async_operation(async_database& owner, function_type const& function);
+
+    bool   await_ready() const noexcept;
+    void   await_suspend(std::coroutine_handle<> handle);
+    Result await_resume();
+
+
+private:
+    using value_type = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+
+    async_database*           m_owner    = nullptr;
+    function_type             m_function = {};
+    std::optional<value_type> m_value    = {};
+    std::exception_ptr        m_error    = {};
+};
+
+
+// rows of one query, fetched a batch at a time on the connection it was
+// started on; co_await next() yields std::nullopt after the last row
+class row_stream
+{
+public:
+    class next_operation
+    {
+    public:
+        next_operation() = delete;
+        ~next_operation() = default;
+
+        explicit next_operation(row_stream& stream);
+
+        bool               await_ready() const noexcept;
+        void               await_suspend(std::coroutine_handle<> handle);
+        std::optional<row> await_resume();
+
+
+    private:
+        row_stream* m_stream = nullptr;
+    };
+
+    row_stream() = delete;
+    ~row_stream();
+
+    row_stream(row_stream&& other) noexcept;
+    row_stream& operator=(row_stream&& other) noexcept;
+
+    row_stream(row_stream const&)            = delete;
+    row_stream& operator=(row_stream const&) = delete;
+
+    next_operation next();
+
+
+private:
+    friend class async_database;
+
+    struct state
+    {
+        std::string                sql        = {};
+        row                        parameters = {};
+        std::size_t                batch      = 0;
+        std::optional<statement>   stmt       = {};
+        std::deque<row>            rows       = {};
+        bool                       done       = false;
+        std::exception_ptr         error      = {};
+
+        void fetch(database& db);
+    };
+
+    row_stream(async_database&    owner,
+               std::size_t const& connection,
+               std::string const& sql_,
+               row const&         row_,
+               std::size_t const& batch);
+
+    void release();
+
+    async_database*        m_owner      = nullptr;
+    std::size_t            m_connection = 0;
+    std::shared_ptr<state> m_state      = {};
+};
+
+
+// a pool of connections to one database, each owned by its own thread so
+// that awaiting coroutines never block on sqlite; a coroutine resumes
+// through the executor, or on the connection thread when there is none,
+// in which case it should not do long work before its next co_await
+class async_database
+{
+public:
+    using executor = std::function<void(std::coroutine_handle<>)>;
+
+    async_database() = delete;
+    ~async_database();
+
+    async_database(std::string const& path,
+                   int const&         flags,
+                   std::size_t const& connections,
+                   executor const&    executor_ = {});
+
+    async_database(async_database const&)            = delete;
+    async_database& operator=(async_database const&) = delete;
+
+    std::size_t size() const;
+    std::size_t pending() const;
+
+    async_operation<std::vector<row>> execute(std::string const& sql_,
+                                              row const&         row_ = {});
+
+    // the stream must not outlive the database
+    row_stream stream(std::string const& sql_,
+                      row const&         row_  = {},
+                      std::size_t const& batch = 256);
+
+    // runs the function with a pool connection, e.g. to configure it or
+    // to keep several statements on one connection
+    template <typename Function>
+    async_operation<std::invoke_result_t<Function, database&>>
+    run(Function&& function);
+
+
+private:
+    template <typename Result>
+    friend class async_operation;
+    friend class row_stream;
+
+    struct connection
+    {
+        database db;
+        worker   thread;
+    };
+
+    std::size_t select() const;
+    void        dispatch(std::size_t const&                   index,
+                         std::function<void(database&)> const& task);
+    void        resume(std::coroutine_handle<> const& handle) const;
+
+    std::vector<std::unique_ptr<connection>> m_connections = {};
+    executor                                 m_executor    = {};
+    mutable std::atomic<std::size_t>         m_next        = {0};
+};
+
+
+template <typename Result>
+async_operation<Result>::async_operation(async_database&      owner,
+                                         function_type const& function)
+    : m_owner {&owner}
+    , m_function {function}
+{
+}
+
+
+template <typename Result>
+bool async_operation<Result>::await_ready() const noexcept
+{
+    return false;
+}
+
+
+template <typename Result>
+void async_operation<Result>::await_suspend(std::coroutine_handle<> handle)
+{
+    async_database* const owner = m_owner;
+
+    // the coroutine may be resumed, and this object destroyed, before
+    // dispatch() returns
+    owner->dispatch(owner->select(),
+                    [this, owner, handle](database& db)
+                    {
+                        try
+                        {
+                            if constexpr (std::is_void_v<Result>)
+                            {
+                                m_function(db);
+                                m_value = true;
+                            }
+                            else
+                            {
+                                m_value.emplace(m_function(db));
+                            }
+                        }
+                        catch (...)
+                        {
+                            m_error = std::current_exception();
+                        }
+                        owner->resume(handle);
+                    });
+}
+
+
+template <typename Result>
+Result async_operation<Result>::await_resume()
+{
+    if (m_error)
+        std::rethrow_exception(m_error);
+    if constexpr (!std::is_void_v<Result>)
+        return std::move(*m_value);
+}
+
+
+template <typename Function>
+async_operation<std::invoke_result_t<Function, database&>>
+async_database::run(Function&& function)
+{
+    return {*this, std::forward<Function>(function)};
+}
+} // namespace sqlite
+} // namespace mm
+
+#endif
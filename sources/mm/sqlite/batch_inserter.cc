@@ -0,0 +1,322 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "batch_inserter.hh"
+#include "errors.hh"
+#include "utilities.hh"
+#include <algorithm>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+std::string joined(std::vector<std::string> const& identifiers)
+{
+    std::string result {};
+    for (auto const& v : identifiers)
+    {
+        if (!result.empty())
+            result += ", ";
+        result += quote_identifier(v);
+    }
+    return result;
+}
+} // namespace
+
+
+void batch_inserter::finalizer::operator()(sqlite3_stmt* stmt) const
+{
+    sqlite3_finalize(stmt);
+}
+
+
+batch_inserter::~batch_inserter() = default;
+
+
+batch_inserter::batch_inserter(database&                       database_,
+                               std::string const&              table,
+                               std::vector<std::string> const& columns)
+    : m_database {database_}
+    , m_table {table}
+    , m_columns {columns}
+{
+    valid_sqlite_identifier(m_table);
+    for (auto const& v : m_columns)
+        valid_sqlite_identifier(v);
+
+    if (m_columns.empty())
+        throw std::runtime_error {"Batch insert without columns."};
+}
+
+
+void batch_inserter::upsert(std::vector<std::string> const& conflict_columns,
+                            std::vector<std::string> const& update_columns)
+{
+    if (conflict_columns.empty())
+        throw std::runtime_error {"Upsert without conflict columns."};
+
+    for (auto const& v : conflict_columns)
+        valid_sqlite_identifier(v);
+    for (auto const& v : update_columns)
+    {
+        valid_sqlite_identifier(v);
+        if (std::find(m_columns.begin(), m_columns.end(), v) ==
+            m_columns.end())
+            throw std::runtime_error {"Upsert of a column [" + v +
+                                      "] that is not inserted."};
+    }
+
+    m_conflict_columns = conflict_columns;
+    m_update_columns   = update_columns;
+    m_upsert           = true;
+
+    m_full    = {};
+    m_partial = {};
+}
+
+
+void batch_inserter::rows_per_statement(std::size_t const& rows)
+{
+    if (!rows)
+        throw std::runtime_error {"Invalid rows per statement."};
+    m_rows_per_statement = rows;
+}
+
+
+std::size_t const& batch_inserter::rows_per_statement() const
+{
+    return m_rows_per_statement;
+}
+
+
+std::size_t batch_inserter::insert(std::vector<row> const& rows)
+{
+    return insert(rows.begin(), rows.end());
+}
+
+
+std::size_t batch_inserter::insert_rows(std::vector<row const*> const& rows)
+{
+    if (!m_database.opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    if (rows.empty())
+        return 0;
+
+    // statements belong to the connection they were prepared on
+    if (m_handle != m_database.handle())
+    {
+        m_full    = {};
+        m_partial = {};
+        m_handle  = m_database.handle();
+    }
+
+    std::size_t const per_statement = capacity();
+    std::size_t const full          = rows.size() / per_statement;
+    std::size_t const remaining     = rows.size() % per_statement;
+
+    bool const transaction = sqlite3_get_autocommit(m_handle) != 0;
+
+    if (transaction)
+        m_database.execute("BEGIN");
+
+    sqlite3_int64 const before = sqlite3_total_changes64(m_handle);
+
+    try
+    {
+        if (full)
+        {
+            sqlite3_stmt* const stmt = prepared(m_full, per_statement);
+            for (std::size_t i = 0; i < full; ++i)
+                run(stmt, rows, i * per_statement, per_statement);
+        }
+
+        if (remaining)
+            run(prepared(m_partial, remaining),
+                rows,
+                full * per_statement,
+                remaining);
+
+        if (transaction)
+            m_database.execute("COMMIT");
+
+        invalidate();
+    }
+    catch (...)
+    {
+        try
+        {
+            if (transaction)
+                m_database.execute("ROLLBACK");
+            invalidate();
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+
+    return static_cast<std::size_t>(sqlite3_total_changes64(m_handle) -
+                                    before);
+}
+
+
+std::string batch_inserter::sql(std::size_t const& rows) const
+{
+    std::string tuple = "(?";
+    for (std::size_t i = 1; i < m_columns.size(); ++i)
+        tuple += ",?";
+    tuple += ")";
+
+    std::string result = "INSERT INTO " + quote_identifier(m_table) +
+                         " (" + joined(m_columns) + ") VALUES ";
+
+    result.reserve(result.size() + rows * (tuple.size() + 1) + 64);
+
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        if (i)
+            result += ",";
+        result += tuple;
+    }
+
+    if (!m_upsert)
+        return result;
+
+    result += " ON CONFLICT (" + joined(m_conflict_columns) + ") DO ";
+
+    if (m_update_columns.empty())
+        return result + "NOTHING";
+
+    result += "UPDATE SET ";
+    for (std::size_t i = 0; i < m_update_columns.size(); ++i)
+    {
+        if (i)
+            result += ", ";
+        result += quote_identifier(m_update_columns[i]) + " = excluded." +
+                  quote_identifier(m_update_columns[i]);
+    }
+
+    return result;
+}
+
+
+std::size_t batch_inserter::capacity() const
+{
+    int const limit = sqlite3_limit(m_handle, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+
+    std::size_t const rows =
+        static_cast<std::size_t>(limit > 0 ? limit : 0) / m_columns.size();
+
+    if (!rows)
+        throw std::runtime_error {"Too many columns for one sqlite statement."};
+
+    return std::min(rows, m_rows_per_statement);
+}
+
+
+void batch_inserter::invalidate() const
+{
+    if (!m_database.cache())
+        return;
+
+    // the authorizer of a prepared insert also reports the tables written
+    // by triggers, which the update hook misses for WITHOUT ROWID tables
+    auto const stmt = m_database.prepare(sql(1));
+    for (auto const& table : stmt.written_tables())
+        m_database.invalidate_cache(table);
+}
+
+
+sqlite3_stmt* batch_inserter::prepared(cached_statement& cache,
+                                       std::size_t const& rows)
+{
+    if (cache.stmt && cache.rows == rows)
+        return cache.stmt.get();
+
+    cache = {};
+
+    std::string const text = sql(rows);
+    sqlite3_stmt*     stmt = nullptr;
+
+    if (sqlite3_prepare_v3(m_handle,
+                           text.c_str(),
+                           static_cast<int>(text.size()),
+                           SQLITE_PREPARE_PERSISTENT,
+                           &stmt,
+                           nullptr) != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        throw std::runtime_error {"Failed to prepare sqlite statement."};
+    }
+
+    cache.stmt.reset(stmt);
+    cache.rows = rows;
+    return stmt;
+}
+
+
+void batch_inserter::run(sqlite3_stmt*                  stmt,
+                         std::vector<row const*> const& rows,
+                         std::size_t const&             first,
+                         std::size_t const&             count)
+{
+    int index = 1;
+
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        auto const& values = rows[i]->columns();
+
+        for (auto const& name : m_columns)
+        {
+            auto const found = values.find(name);
+            if (found == values.end())
+            {
+                if (sqlite3_bind_null(stmt, index) != SQLITE_OK)
+                    throw std::runtime_error {
+                        "Failed to bind value to sqlite statement."};
+            }
+            else
+            {
+                found->second.bind(stmt, index);
+            }
+            ++index;
+        }
+    }
+
+    int const result = sqlite3_step(stmt);
+
+    if (result == SQLITE_DONE)
+    {
+        sqlite3_reset(stmt);
+        return;
+    }
+
+    std::string const message = sqlite3_errmsg(m_handle);
+    sqlite3_reset(stmt);
+
+    if ((result & 0xff) == SQLITE_BUSY)
+        throw busy_error {"Database is busy, failed to insert rows."};
+    throw std::runtime_error {"Failed to insert rows [" + message + "]."};
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,115 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <sqlite3.h>
+#include "row.hh"
+#include "database.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// inserts rows through cached multi-row INSERT ... VALUES (?,?),(?,?)
+// statements, binding values by position; a statement carries at most
+// rows_per_statement rows and stays under SQLITE_LIMIT_VARIABLE_NUMBER,
+// the remaining rows go through a second cached statement. row columns
+// are matched by name, missing ones are inserted as NULL
+class batch_inserter
+{
+public:
+    batch_inserter() = delete;
+    ~batch_inserter();
+
+    batch_inserter(database&                       database_,
+                   std::string const&              table,
+                   std::vector<std::string> const& columns);
+
+    batch_inserter(batch_inserter const&)            = delete;
+    batch_inserter& operator=(batch_inserter const&) = delete;
+
+    // turns the insert into an upsert on the conflict columns, the update
+    // columns take the conflicting row's values; without update columns
+    // conflicting rows are skipped
+    void upsert(std::vector<std::string> const& conflict_columns,
+                std::vector<std::string> const& update_columns = {});
+
+    void               rows_per_statement(std::size_t const& rows);
+    std::size_t const& rows_per_statement() const;
+
+    // runs in one transaction unless one is already open, returns the
+    // number of rows changed
+    std::size_t insert(std::vector<row> const& rows);
+
+    template <typename Iterator>
+    std::size_t insert(Iterator first, Iterator last);
+
+
+private:
+    struct finalizer
+    {
+        void operator()(sqlite3_stmt* stmt) const;
+    };
+
+    using statement_ptr = std::unique_ptr<sqlite3_stmt, finalizer>;
+
+    struct cached_statement
+    {
+        statement_ptr stmt = {};
+        std::size_t   rows = 0;
+    };
+
+    std::size_t insert_rows(std::vector<row const*> const& rows);
+    std::string sql(std::size_t const& rows) const;
+    std::size_t capacity() const;
+    void        invalidate() const;
+
+    sqlite3_stmt* prepared(cached_statement& cache, std::size_t const& rows);
+    void          run(sqlite3_stmt*                  stmt,
+                      std::vector<row const*> const& rows,
+                      std::size_t const&             first,
+                      std::size_t const&             count);
+
+    database&                m_database;
+    std::string              m_table;
+    std::vector<std::string> m_columns            = {};
+    std::vector<std::string> m_conflict_columns   = {};
+    std::vector<std::string> m_update_columns     = {};
+    bool                     m_upsert             = false;
+    std::size_t              m_rows_per_statement = 256;
+    sqlite3*                 m_handle             = nullptr;
+    cached_statement         m_full               = {};
+    cached_statement         m_partial            = {};
+};
+
+
+template <typename Iterator>
+std::size_t batch_inserter::insert(Iterator first, Iterator last)
+{
+    std::vector<row const*> rows = {};
+    for (; first != last; ++first)
+        rows.push_back(&*first);
+    return insert_rows(rows);
+}
+} // namespace sqlite
+} // namespace mm
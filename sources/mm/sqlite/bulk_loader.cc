@@ -0,0 +1,876 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "bulk_loader.hh"
+#include "utilities.hh"
+#include "mapped_file.hh"
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <exception>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <sys/mman.h>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+struct finalizer
+{
+    void operator()(sqlite3_stmt* stmt) const { sqlite3_finalize(stmt); }
+};
+
+
+using statement_ptr = std::unique_ptr<sqlite3_stmt, finalizer>;
+
+
+struct field
+{
+    char const* data    = nullptr;
+    std::size_t size    = 0;
+    bool        escaped = false;
+};
+
+
+char const* skip_space(char const* p, char const* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        ++p;
+    return p;
+}
+
+
+// one CSV record (RFC 4180), returns the start of the next record
+char const* parse_csv(char const*         p,
+                      char const*         end,
+                      char const&         delimiter,
+                      std::vector<field>& fields)
+{
+    fields.clear();
+
+    while (true)
+    {
+        field f {p, 0, false};
+
+        if (p < end && *p == '"')
+        {
+            f.data = ++p;
+
+            while (true)
+            {
+                auto const* q = static_cast<char const*>(
+                    std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+
+                if (!q)
+                    throw std::runtime_error {"Unterminated quoted csv field."};
+
+                if (q + 1 < end && q[1] == '"')
+                {
+                    f.escaped = true;
+                    p         = q + 2;
+                    continue;
+                }
+
+                f.size = static_cast<std::size_t>(q - f.data);
+                p      = q + 1;
+                break;
+            }
+
+            if (p < end && *p != delimiter && *p != '\r' && *p != '\n')
+                throw std::runtime_error {"Invalid quoted csv field."};
+        }
+        else
+        {
+            while (p < end && *p != delimiter && *p != '\n' && *p != '\r')
+                ++p;
+            f.size = static_cast<std::size_t>(p - f.data);
+        }
+
+        fields.push_back(f);
+
+        if (p >= end)
+            return end;
+
+        if (*p == delimiter)
+        {
+            ++p;
+            continue;
+        }
+
+        if (*p == '\r')
+            ++p;
+        if (p < end && *p == '\n')
+            ++p;
+
+        return p;
+    }
+}
+
+
+void unescape_csv(field const& f, std::string& buffer)
+{
+    buffer.clear();
+    for (std::size_t i = 0; i < f.size; ++i)
+    {
+        buffer += f.data[i];
+        if (f.data[i] == '"')
+            ++i;
+    }
+}
+
+
+void append_utf8(std::string& buffer, std::uint32_t code)
+{
+    if (code < 0x80)
+    {
+        buffer += static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+        buffer += static_cast<char>(0xc0 | (code >> 6));
+        buffer += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else if (code < 0x10000)
+    {
+        buffer += static_cast<char>(0xe0 | (code >> 12));
+        buffer += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        buffer += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        buffer += static_cast<char>(0xf0 | (code >> 18));
+        buffer += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        buffer += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        buffer += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+
+std::uint32_t parse_hex4(char const* p, char const* end)
+{
+    std::uint32_t code = 0;
+    if (end - p < 4 || std::from_chars(p, p + 4, code, 16).ptr != p + 4)
+        throw std::runtime_error {"Invalid json unicode escape."};
+    return code;
+}
+
+
+void unescape_json(field const& f, std::string& buffer)
+{
+    buffer.clear();
+
+    char const*       p   = f.data;
+    char const* const end = f.data + f.size;
+
+    while (p < end)
+    {
+        if (*p != '\\')
+        {
+            buffer += *p++;
+            continue;
+        }
+
+        if (++p >= end)
+            throw std::runtime_error {"Invalid json escape."};
+
+        switch (*p++)
+        {
+        case '"':
+        case '\\':
+        case '/':
+        {
+            buffer += p[-1];
+            break;
+        }
+        case 'b':
+        {
+            buffer += '\b';
+            break;
+        }
+        case 'f':
+        {
+            buffer += '\f';
+            break;
+        }
+        case 'n':
+        {
+            buffer += '\n';
+            break;
+        }
+        case 'r':
+        {
+            buffer += '\r';
+            break;
+        }
+        case 't':
+        {
+            buffer += '\t';
+            break;
+        }
+        case 'u':
+        {
+            std::uint32_t code = parse_hex4(p, end);
+            p += 4;
+
+            // surrogate pair
+            if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 &&
+                p[0] == '\\' && p[1] == 'u')
+            {
+                std::uint32_t const low = parse_hex4(p + 2, end);
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    p += 6;
+                }
+            }
+
+            append_utf8(buffer, code);
+            break;
+        }
+        default:
+        {
+            throw std::runtime_error {"Invalid json escape."};
+        }
+        }
+    }
+}
+
+
+// a json string starting after its opening quote
+char const* parse_json_string(char const* p, char const* end, field& f)
+{
+    f = field {p, 0, false};
+
+    while (p < end && *p != '"')
+    {
+        // a trailing backslash must not step past the end
+        if (*p == '\\')
+        {
+            if (p + 1 >= end)
+                throw std::runtime_error {"Unterminated JSON string."};
+            f.escaped = true;
+            ++p;
+        }
+        ++p;
+    }
+
+    if (p >= end)
+        throw std::runtime_error {"Unterminated JSON string."};
+
+    f.size = static_cast<std::size_t>(p - f.data);
+    return p + 1;
+}
+
+
+// a nested object or array kept as json text
+char const* skip_json_container(char const* p, char const* end)
+{
+    int depth = 0;
+
+    while (p < end)
+    {
+        char const chr = *p++;
+
+        if (chr == '"')
+        {
+            field ignored {};
+            p = parse_json_string(p, end, ignored);
+        }
+        else if (chr == '{' || chr == '[')
+        {
+            ++depth;
+        }
+        else if ((chr == '}' || chr == ']') && --depth == 0)
+        {
+            return p;
+        }
+    }
+
+    throw std::runtime_error {"Unterminated json value."};
+}
+
+
+void check(int const& index, int const& result)
+{
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to bind value to sqlite statement [" +
+                                  std::to_string(index) + "]."};
+}
+
+
+void bind_text(sqlite3_stmt* stmt,
+               int const&    index,
+               char const*   data,
+               std::size_t   size)
+{
+    // values stay valid until the row is stepped
+    check(index,
+          sqlite3_bind_text64(
+              stmt, index, data, size, SQLITE_STATIC, SQLITE_UTF8));
+}
+
+
+void bind_number(sqlite3_stmt* stmt, int const& index, field const& f)
+{
+    char const* const end = f.data + f.size;
+
+    bool integer = true;
+    for (char const* p = f.data; p < end; ++p)
+        if (*p == '.' || *p == 'e' || *p == 'E')
+            integer = false;
+
+    if (integer)
+    {
+        sqlite3_int64 value = 0;
+        if (std::from_chars(f.data, end, value).ptr == end)
+        {
+            check(index, sqlite3_bind_int64(stmt, index, value));
+            return;
+        }
+    }
+
+    double value = 0.0;
+    if (std::from_chars(f.data, end, value).ptr != end)
+        throw std::runtime_error {"Invalid json number."};
+
+    check(index, sqlite3_bind_double(stmt, index, value));
+}
+
+
+void step(sqlite3* db, sqlite3_stmt* stmt)
+{
+    int const result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    if (result != SQLITE_DONE)
+        throw std::runtime_error {std::string {"Failed to insert row ["} +
+                                  sqlite3_errmsg(db) + "]."};
+}
+} // namespace
+
+
+double bulk_loader::statistics::rows_per_second() const
+{
+    return seconds > 0 ? static_cast<double>(rows) / seconds : 0.0;
+}
+
+
+double bulk_loader::statistics::bytes_per_second() const
+{
+    return seconds > 0 ? static_cast<double>(bytes) / seconds : 0.0;
+}
+
+
+bulk_loader::~bulk_loader() = default;
+
+
+bulk_loader::bulk_loader(database&                       database_,
+                         std::string const&              table,
+                         std::vector<std::string> const& columns)
+    : m_database {database_}
+    , m_table {table}
+    , m_columns {columns}
+{
+    valid_sqlite_identifier(m_table);
+    for (auto const& v : m_columns)
+        valid_sqlite_identifier(v);
+}
+
+
+void bulk_loader::format(file_format const& format_) { m_format = format_; }
+
+
+file_format const& bulk_loader::format() const { return m_format; }
+
+
+void bulk_loader::delimiter(char const& delimiter_)
+{
+    if (delimiter_ == '"' || delimiter_ == '\n' || delimiter_ == '\r')
+        throw std::runtime_error {"Invalid csv delimiter."};
+    m_delimiter = delimiter_;
+}
+
+
+char const& bulk_loader::delimiter() const { return m_delimiter; }
+
+
+void bulk_loader::header(bool const& header_) { m_header = header_; }
+
+
+bool const& bulk_loader::header() const { return m_header; }
+
+
+void bulk_loader::batch_size(std::size_t const& rows)
+{
+    if (rows == 0)
+        throw std::runtime_error {"Invalid batch size."};
+    m_batch_size = rows;
+}
+
+
+std::size_t const& bulk_loader::batch_size() const { return m_batch_size; }
+
+
+void bulk_loader::empty_as_null(bool const& enable)
+{
+    m_empty_as_null = enable;
+}
+
+
+bool const& bulk_loader::empty_as_null() const { return m_empty_as_null; }
+
+
+void bulk_loader::bulk_pragmas(bool const& enable) { m_bulk_pragmas = enable; }
+
+
+bool const& bulk_loader::bulk_pragmas() const { return m_bulk_pragmas; }
+
+
+void bulk_loader::cache_size(int const& kibibytes)
+{
+    if (kibibytes <= 0)
+        throw std::runtime_error {"Invalid cache size."};
+    m_cache_size = kibibytes;
+}
+
+
+int const& bulk_loader::cache_size() const { return m_cache_size; }
+
+
+void bulk_loader::defer_indexes(bool const& enable)
+{
+    m_defer_indexes = enable;
+}
+
+
+bool const& bulk_loader::defer_indexes() const { return m_defer_indexes; }
+
+
+bulk_loader::statistics bulk_loader::load(std::string const& path)
+{
+    if (!m_database.opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    auto const started = std::chrono::steady_clock::now();
+
+    mapped_file const file {path};
+    file.advise(MADV_SEQUENTIAL);
+
+    char const*       p   = file.data();
+    char const* const end = file.data() + file.size();
+
+    std::vector<field> fields {};
+    fields.reserve(64);
+
+    std::vector<std::string> columns = m_columns;
+
+    if (m_format == file_format::CSV && m_header && p < end)
+    {
+        p = parse_csv(p, end, m_delimiter, fields);
+
+        if (columns.empty())
+        {
+            std::string name {};
+            for (auto const& f : fields)
+            {
+                unescape_csv(f, name);
+                valid_sqlite_identifier(name);
+                columns.push_back(name);
+            }
+        }
+    }
+
+    if (columns.empty())
+        throw std::runtime_error {"No columns to load."};
+
+    std::string sql = "INSERT INTO " + quote_identifier(m_table) + " (";
+    for (auto const& v : columns)
+        sql += quote_identifier(v) + ",";
+    sql.back() = ')';
+    sql += " VALUES (";
+    for (std::size_t i = 0; i < columns.size(); ++i)
+        sql += "?,";
+    sql.back() = ')';
+
+    // [ bulk settings
+
+    std::vector<std::string> restore {};
+    std::vector<std::string> indexes {};
+
+    auto const rollback = [this]()
+    {
+        try
+        {
+            if (!sqlite3_get_autocommit(m_database.handle()))
+                m_database.execute("ROLLBACK");
+        }
+        catch (...)
+        {
+        }
+    };
+
+    // the indexes are recreated together or not at all, and every setting
+    // is restored even when an earlier one fails
+    auto const restore_settings = [this, &restore, &indexes, &rollback]()
+    {
+        std::exception_ptr error {};
+
+        if (!indexes.empty())
+        {
+            try
+            {
+                m_database.execute("BEGIN");
+                for (auto const& v : indexes)
+                    m_database.execute(v);
+                m_database.execute("COMMIT");
+                indexes.clear();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                rollback();
+            }
+        }
+
+        for (auto const& v : restore)
+        {
+            try
+            {
+                m_database.execute(v);
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        restore.clear();
+
+        if (error)
+            std::rethrow_exception(error);
+    };
+
+    if (m_defer_indexes)
+    {
+        // unique indexes reject duplicates while loading, only indexes made
+        // by CREATE INDEX have sql to be recreated from
+        auto const deferred = m_database.execute(
+            "SELECT l.name AS name, m.sql AS sql "
+            "FROM pragma_index_list(:table) AS l "
+            "JOIN sqlite_master AS m ON m.name = l.name "
+            "WHERE l.\"unique\" = 0 AND l.origin = 'c' AND m.type = 'index'",
+            row {"table", column {m_table, "table"}});
+
+        if (!deferred.empty())
+        {
+            m_database.execute("BEGIN");
+
+            try
+            {
+                for (auto const& v : deferred)
+                    m_database.execute(
+                        "DROP INDEX " +
+                        quote_identifier(v.columns().at("name").value()));
+                m_database.execute("COMMIT");
+            }
+            catch (...)
+            {
+                rollback();
+                throw;
+            }
+
+            for (auto const& v : deferred)
+                indexes.push_back(v.columns().at("sql").value());
+        }
+    }
+
+    try
+    {
+        if (m_bulk_pragmas)
+        {
+            restore.push_back("PRAGMA synchronous = " +
+                              m_database.execute("PRAGMA synchronous")
+                                  .at(0)
+                                  .columns()
+                                  .at("synchronous")
+                                  .value());
+            restore.push_back("PRAGMA cache_size = " +
+                              m_database.execute("PRAGMA cache_size")
+                                  .at(0)
+                                  .columns()
+                                  .at("cache_size")
+                                  .value());
+
+            m_database.execute("PRAGMA synchronous = OFF");
+            m_database.execute("PRAGMA cache_size = -" +
+                               std::to_string(m_cache_size));
+        }
+    }
+    catch (...)
+    {
+        try
+        {
+            restore_settings();
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+
+    // ] bulk settings
+
+    // the authorizer of the prepared insert also reports the tables written
+    // by triggers, which the update hook misses for WITHOUT ROWID tables
+    auto const invalidate = [this, &sql]()
+    {
+        if (!m_database.cache())
+            return;
+        auto const stmt = m_database.prepare(sql);
+        for (auto const& table : stmt.written_tables())
+            m_database.invalidate_cache(table);
+    };
+
+    statistics stats {};
+    bool       transaction = false;
+
+    try
+    {
+        sqlite3* const db   = m_database.handle();
+        sqlite3_stmt*  stmt = nullptr;
+
+        if (sqlite3_prepare_v3(db,
+                               sql.c_str(),
+                               -1,
+                               SQLITE_PREPARE_PERSISTENT,
+                               &stmt,
+                               nullptr) != SQLITE_OK)
+            throw std::runtime_error {"Failed to prepare sqlite statement."};
+
+        statement_ptr const insert {stmt};
+
+        std::vector<std::string> buffers(columns.size());
+
+        std::unordered_map<std::string_view, int> positions {};
+        for (std::size_t i = 0; i < columns.size(); ++i)
+            positions.emplace(columns[i], static_cast<int>(i + 1));
+
+        std::string key {};
+        std::size_t in_batch = 0;
+
+        while (true)
+        {
+            // blank lines are skipped
+            while (p < end && (*p == '\n' || *p == '\r'))
+                ++p;
+
+            if (p >= end)
+                break;
+
+            if (!transaction)
+            {
+                m_database.execute("BEGIN");
+                transaction = true;
+            }
+
+            if (m_format == file_format::CSV)
+            {
+                p = parse_csv(p, end, m_delimiter, fields);
+
+                if (fields.size() != columns.size())
+                    throw std::runtime_error {
+                        "Csv record [" + std::to_string(stats.rows + 1) +
+                        "] has " + std::to_string(fields.size()) +
+                        " fields, expected " + std::to_string(columns.size()) +
+                        "."};
+
+                for (std::size_t i = 0; i < fields.size(); ++i)
+                {
+                    auto const& f     = fields[i];
+                    int const   index = static_cast<int>(i + 1);
+
+                    if (f.size == 0 && m_empty_as_null)
+                    {
+                        check(index, sqlite3_bind_null(stmt, index));
+                    }
+                    else if (f.escaped)
+                    {
+                        unescape_csv(f, buffers[i]);
+                        bind_text(
+                            stmt, index, buffers[i].data(), buffers[i].size());
+                    }
+                    else
+                    {
+                        bind_text(stmt, index, f.data, f.size);
+                    }
+                }
+            }
+            else
+            {
+                sqlite3_clear_bindings(stmt);
+
+                p = skip_space(p, end);
+                if (p >= end || *p++ != '{')
+                    throw std::runtime_error {"Json record [" +
+                                              std::to_string(stats.rows + 1) +
+                                              "] is not an object."};
+
+                while (true)
+                {
+                    p = skip_space(p, end);
+
+                    if (p < end && *p == '}')
+                    {
+                        ++p;
+                        break;
+                    }
+
+                    if (p >= end || *p++ != '"')
+                        throw std::runtime_error {"Invalid json object key."};
+
+                    field name {};
+                    p = parse_json_string(p, end, name);
+
+                    std::string_view name_view {name.data, name.size};
+                    if (name.escaped)
+                    {
+                        unescape_json(name, key);
+                        name_view = key;
+                    }
+
+                    auto const found = positions.find(name_view);
+                    int const  index =
+                        found == positions.end() ? 0 : found->second;
+
+                    p = skip_space(p, end);
+                    if (p >= end || *p++ != ':')
+                        throw std::runtime_error {"Invalid json object."};
+                    p = skip_space(p, end);
+
+                    if (p >= end)
+                        throw std::runtime_error {"Invalid json object."};
+
+                    char const* const value = p;
+
+                    if (*p == '"')
+                    {
+                        field f {};
+                        p = parse_json_string(p + 1, end, f);
+
+                        if (index && f.escaped)
+                        {
+                            auto& buffer =
+                                buffers[static_cast<std::size_t>(index - 1)];
+                            unescape_json(f, buffer);
+                            bind_text(
+                                stmt, index, buffer.data(), buffer.size());
+                        }
+                        else if (index)
+                        {
+                            bind_text(stmt, index, f.data, f.size);
+                        }
+                    }
+                    else if (*p == '{' || *p == '[')
+                    {
+                        p = skip_json_container(p, end);
+                        if (index)
+                            bind_text(stmt,
+                                      index,
+                                      value,
+                                      static_cast<std::size_t>(p - value));
+                    }
+                    else
+                    {
+                        while (p < end && *p != ',' && *p != '}' && *p != ' ' &&
+                               *p != '\t' && *p != '\r' && *p != '\n')
+                            ++p;
+
+                        field const f {value,
+                                       static_cast<std::size_t>(p - value),
+                                       false};
+                        std::string_view const literal {f.data, f.size};
+
+                        // null stays unbound
+                        if (index && literal == "true")
+                            check(index, sqlite3_bind_int(stmt, index, 1));
+                        else if (index && literal == "false")
+                            check(index, sqlite3_bind_int(stmt, index, 0));
+                        else if (index && literal != "null")
+                            bind_number(stmt, index, f);
+                    }
+
+                    p = skip_space(p, end);
+                    if (p < end && *p == ',')
+                        ++p;
+                }
+            }
+
+            step(db, stmt);
+
+            ++stats.rows;
+
+            if (++in_batch >= m_batch_size)
+            {
+                m_database.execute("COMMIT");
+                transaction = false;
+                in_batch    = 0;
+                ++stats.transactions;
+            }
+        }
+
+        if (transaction)
+        {
+            m_database.execute("COMMIT");
+            transaction = false;
+            ++stats.transactions;
+        }
+    }
+    catch (...)
+    {
+        try
+        {
+            if (transaction)
+                m_database.execute("ROLLBACK");
+            invalidate();
+            restore_settings();
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+
+    invalidate();
+    restore_settings();
+
+    stats.bytes   = file.size();
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - started)
+                        .count();
+
+    return stats;
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,100 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "enums.hh"
+#include "database.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// loads CSV or NDJSON files into a table through one cached INSERT,
+// committing every batch_size rows; batches committed before a failure
+// stay loaded. while loading, synchronous is OFF, the page cache is enlarged
+// and the table's non-unique explicit indexes are dropped and rebuilt
+// afterwards, both in one transaction
+class bulk_loader
+{
+public:
+    struct statistics
+    {
+        std::uint64_t rows         = 0;
+        std::uint64_t bytes        = 0;
+        std::uint64_t transactions = 0;
+        double        seconds      = 0.0;
+
+        double rows_per_second() const;
+        double bytes_per_second() const;
+    };
+
+    bulk_loader() = delete;
+    ~bulk_loader();
+
+    // without columns the header line of a CSV file names them
+    bulk_loader(database&                       database_,
+                std::string const&              table,
+                std::vector<std::string> const& columns = {});
+
+    void               format(file_format const& format_);
+    file_format const& format() const;
+
+    void        delimiter(char const& delimiter_);
+    char const& delimiter() const;
+
+    void        header(bool const& header_);
+    bool const& header() const;
+
+    void               batch_size(std::size_t const& rows);
+    std::size_t const& batch_size() const;
+
+    void        empty_as_null(bool const& enable);
+    bool const& empty_as_null() const;
+
+    void        bulk_pragmas(bool const& enable);
+    bool const& bulk_pragmas() const;
+
+    void        cache_size(int const& kibibytes);
+    int const&  cache_size() const;
+
+    void        defer_indexes(bool const& enable);
+    bool const& defer_indexes() const;
+
+    statistics load(std::string const& path);
+
+
+private:
+    database&                m_database;
+    std::string              m_table;
+    std::vector<std::string> m_columns       = {};
+    file_format              m_format        = file_format::CSV;
+    char                     m_delimiter     = ',';
+    bool                     m_header        = false;
+    std::size_t              m_batch_size    = 100000;
+    bool                     m_empty_as_null = false;
+    bool                     m_bulk_pragmas  = true;
+    int                      m_cache_size    = 256 * 1024;
+    bool                     m_defer_indexes = true;
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,94 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "busy_policy.hh"
+#include <random>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+busy_policy::busy_policy() = default;
+
+
+busy_policy::~busy_policy() = default;
+
+
+busy_policy::busy_policy(std::chrono::milliseconds const& timeout_,
+                         std::chrono::microseconds const& initial_delay_,
+                         std::chrono::microseconds const& max_delay_,
+                         bool const&                      jitter_)
+    : m_timeout {timeout_}
+    , m_initial_delay {initial_delay_}
+    , m_max_delay {max_delay_}
+    , m_jitter {jitter_}
+{
+    if (m_timeout.count() < 0 || m_initial_delay.count() <= 0 ||
+        m_max_delay < m_initial_delay)
+        throw std::runtime_error {"Invalid busy policy."};
+}
+
+
+std::chrono::milliseconds const& busy_policy::timeout() const
+{
+    return m_timeout;
+}
+
+
+std::chrono::microseconds const& busy_policy::initial_delay() const
+{
+    return m_initial_delay;
+}
+
+
+std::chrono::microseconds const& busy_policy::max_delay() const
+{
+    return m_max_delay;
+}
+
+
+bool const& busy_policy::jitter() const { return m_jitter; }
+
+
+std::chrono::microseconds busy_policy::delay(int const& attempt) const
+{
+    // exponential backoff, capped, optionally with "equal jitter" so that
+    // waiters on the same lock do not wake up in lockstep
+
+    auto delay_ = m_initial_delay;
+
+    for (int i = 0; i < attempt && delay_ < m_max_delay; ++i)
+        delay_ *= 2;
+
+    if (delay_ > m_max_delay)
+        delay_ = m_max_delay;
+
+    if (!m_jitter || delay_.count() < 2)
+        return delay_;
+
+    thread_local std::minstd_rand engine {std::random_device {}()};
+
+    std::uniform_int_distribution<std::chrono::microseconds::rep> dist {
+        delay_.count() / 2, delay_.count()};
+
+    return std::chrono::microseconds {dist(engine)};
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,56 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+
+namespace mm
+{
+namespace sqlite
+{
+class busy_policy
+{
+public:
+    busy_policy();
+    ~busy_policy();
+
+    busy_policy(std::chrono::milliseconds const& timeout_,
+                std::chrono::microseconds const& initial_delay_ =
+                    std::chrono::microseconds {100},
+                std::chrono::microseconds const& max_delay_ =
+                    std::chrono::milliseconds {20},
+                bool const& jitter_ = true);
+
+    std::chrono::milliseconds const& timeout() const;
+    std::chrono::microseconds const& initial_delay() const;
+    std::chrono::microseconds const& max_delay() const;
+    bool const&                      jitter() const;
+
+    std::chrono::microseconds delay(int const& attempt) const;
+
+
+private:
+    std::chrono::milliseconds m_timeout       = std::chrono::milliseconds {0};
+    std::chrono::microseconds m_initial_delay = std::chrono::microseconds {100};
+    std::chrono::microseconds m_max_delay     = std::chrono::milliseconds {20};
+    bool                      m_jitter        = true;
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,52 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "cancellation.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+cancellation_token::cancellation_token()
+    : m_cancelled {std::make_shared<std::atomic<bool>>(false)}
+{
+}
+
+
+cancellation_token::~cancellation_token() = default;
+
+
+void cancellation_token::cancel() const
+{
+    m_cancelled->store(true, std::memory_order_release);
+}
+
+
+void cancellation_token::reset() const
+{
+    m_cancelled->store(false, std::memory_order_release);
+}
+
+
+bool cancellation_token::cancelled() const
+{
+    return m_cancelled->load(std::memory_order_acquire);
+}
+} // namespace sqlite
+} // namespace mm
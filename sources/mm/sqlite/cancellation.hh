@@ -0,0 +1,44 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace mm
+{
+namespace sqlite
+{
+class cancellation_token
+{
+public:
+    cancellation_token();
+    ~cancellation_token();
+
+    void cancel() const;
+    void reset() const;
+    bool cancelled() const;
+
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+} // namespace sqlite
+} // namespace mm
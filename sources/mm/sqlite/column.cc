@@ -113,7 +113,7 @@ void column::parameter(std::string const& parameter_)
 }
 
 
-void column::bind(std::shared_ptr<sqlite3_stmt> const& sqlite_statement) const
+void column::bind(sqlite3_stmt* sqlite_statement) const
 {
     if (m_parameter.empty())
         return;
@@ -125,34 +125,40 @@ void column::bind(std::shared_ptr<sqlite3_stmt> const& sqlite_statement) const
     std::string name = ":" + m_parameter;
 
     int const index =
-        sqlite3_bind_parameter_index(sqlite_statement.get(), name.c_str());
+        sqlite3_bind_parameter_index(sqlite_statement, name.c_str());
 
     if (index <= 0)
         return;
 
+    bind(sqlite_statement, index);
+}
+
+
+void column::bind(sqlite3_stmt* sqlite_statement, int const& index) const
+{
+    if (!sqlite_statement)
+        throw std::runtime_error {
+            "Invalid sqlite statement to bind parameter to."};
+
     int result = SQLITE_ERROR;
 
     switch (m_type)
     {
     case data_type::INTEGER:
     {
-        result =
-            sqlite3_bind_int(sqlite_statement.get(), index, to_int(m_value));
+        result = sqlite3_bind_int(sqlite_statement, index, to_int(m_value));
         break;
     }
     case data_type::REAL:
     {
-        result = sqlite3_bind_double(
-            sqlite_statement.get(), index, to_double(m_value));
+        result =
+            sqlite3_bind_double(sqlite_statement, index, to_double(m_value));
         break;
     }
     case data_type::TEXT:
     {
-        result = sqlite3_bind_text(sqlite_statement.get(),
-                                   index,
-                                   m_value.c_str(),
-                                   -1,
-                                   SQLITE_TRANSIENT);
+        result = sqlite3_bind_text(
+            sqlite_statement, index, m_value.c_str(), -1, SQLITE_TRANSIENT);
         break;
     }
     default:
@@ -20,7 +20,6 @@
 #pragma once
 
 #include <string>
-#include <memory>
 #include <sqlite3.h>
 #include "enums.hh"
 
@@ -51,7 +50,8 @@ public:
     void value(std::string const& value_, data_type const& type_);
 
     void parameter(std::string const& parameter_);
-    void bind(std::shared_ptr<sqlite3_stmt> const& sqlite_statement) const;
+    void bind(sqlite3_stmt* sqlite_statement) const;
+    void bind(sqlite3_stmt* sqlite_statement, int const& index) const;
 
 
 private:
@@ -0,0 +1,346 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "configuration.hh"
+#include <array>
+#include <limits>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sqlite3.h>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+// [ thread caching allocator
+
+// blocks carry their rounded size in an 8 byte header; sizes up to 32 KiB
+// are rounded to size classes, 16 bytes apart up to 128 bytes and four per
+// power of two above, and recycled through per thread free lists
+
+constexpr std::size_t header         = 8;
+constexpr std::size_t max_class_size = 32 * 1024;
+constexpr std::size_t class_count    = 40;
+constexpr std::size_t cache_bytes    = 256 * 1024;
+
+
+std::size_t size_class(std::size_t const& size)
+{
+    if (size <= 128)
+        return size <= 16 ? 0 : (size - 1) / 16;
+
+    auto const power =
+        static_cast<std::size_t>(63 - __builtin_clzll(size - 1));
+    auto const step = std::size_t {1} << (power - 2);
+
+    return 8 + (power - 7) * 4 +
+           ((size - 1) - (std::size_t {1} << power)) / step;
+}
+
+
+std::size_t class_size(std::size_t const& index)
+{
+    if (index < 8)
+        return (index + 1) * 16;
+
+    auto const power = 7 + (index - 8) / 4;
+    return (std::size_t {1} << power) +
+           ((index - 8) % 4 + 1) * (std::size_t {1} << (power - 2));
+}
+
+
+std::size_t round_up(std::size_t const& size)
+{
+    if (size > max_class_size)
+        return (size + 7) & ~std::size_t {7};
+    return class_size(size_class(size));
+}
+
+
+struct free_block
+{
+    free_block* next;
+};
+
+
+struct thread_cache
+{
+    std::array<free_block*, class_count> lists = {};
+    std::array<std::size_t, class_count> sizes = {};
+
+    ~thread_cache();
+};
+
+
+thread_local bool cache_destroyed = false;
+
+
+thread_cache::~thread_cache()
+{
+    cache_destroyed = true;
+    for (auto* head : lists)
+    {
+        while (head)
+        {
+            auto* next = head->next;
+            std::free(reinterpret_cast<char*>(head) - header);
+            head = next;
+        }
+    }
+}
+
+
+thread_cache* local_cache()
+{
+    // sqlite may still free memory from destructors running after the
+    // cache of the exiting thread is gone
+    if (cache_destroyed)
+        return nullptr;
+    thread_local thread_cache cache {};
+    return &cache;
+}
+
+
+std::size_t block_size(void* pointer)
+{
+    std::size_t size = 0;
+    std::memcpy(&size, static_cast<char*>(pointer) - header, sizeof(size));
+    return size;
+}
+
+
+void* caching_malloc(int size)
+{
+    if (size <= 0)
+        return nullptr;
+
+    std::size_t const rounded = round_up(static_cast<std::size_t>(size));
+
+    if (rounded <= max_class_size)
+    {
+        if (auto* cache = local_cache())
+        {
+            std::size_t const index = size_class(rounded);
+            if (auto* block = cache->lists[index])
+            {
+                cache->lists[index] = block->next;
+                cache->sizes[index] -= rounded;
+                return block;
+            }
+        }
+    }
+
+    auto* raw = static_cast<char*>(std::malloc(rounded + header));
+    if (!raw)
+        return nullptr;
+
+    std::memcpy(raw, &rounded, sizeof(rounded));
+    return raw + header;
+}
+
+
+void caching_free(void* pointer)
+{
+    if (!pointer)
+        return;
+
+    std::size_t const size = block_size(pointer);
+
+    if (size <= max_class_size)
+    {
+        if (auto* cache = local_cache())
+        {
+            std::size_t const index = size_class(size);
+            if (cache->sizes[index] + size <= cache_bytes)
+            {
+                auto* block         = static_cast<free_block*>(pointer);
+                block->next         = cache->lists[index];
+                cache->lists[index] = block;
+                cache->sizes[index] += size;
+                return;
+            }
+        }
+    }
+
+    std::free(static_cast<char*>(pointer) - header);
+}
+
+
+void* caching_realloc(void* pointer, int size)
+{
+    if (!pointer)
+        return caching_malloc(size);
+
+    std::size_t const old_size = block_size(pointer);
+
+    if (size > 0 && round_up(static_cast<std::size_t>(size)) == old_size)
+        return pointer;
+
+    void* result = caching_malloc(size);
+    if (!result)
+        return nullptr;
+
+    std::size_t const copy = static_cast<std::size_t>(size) < old_size
+                                 ? static_cast<std::size_t>(size)
+                                 : old_size;
+    std::memcpy(result, pointer, copy);
+    caching_free(pointer);
+    return result;
+}
+
+
+int caching_size(void* pointer)
+{
+    return pointer ? static_cast<int>(block_size(pointer)) : 0;
+}
+
+
+int caching_roundup(int size)
+{
+    return static_cast<int>(round_up(static_cast<std::size_t>(size)));
+}
+
+
+int caching_init(void*) { return SQLITE_OK; }
+
+
+void caching_shutdown(void*) {}
+
+// ] thread caching allocator
+
+
+memory_status status(int const& operation, bool const& reset)
+{
+    sqlite3_int64 current   = 0;
+    sqlite3_int64 highwater = 0;
+
+    if (sqlite3_status64(operation, &current, &highwater, reset ? 1 : 0) !=
+        SQLITE_OK)
+        throw std::runtime_error {"Failed to get sqlite memory status."};
+
+    return {current, highwater};
+}
+
+
+void check(int const& result, char const* message)
+{
+    if (result == SQLITE_MISUSE)
+        throw std::runtime_error {
+            "SQLite must be configured before it is initialized."};
+    if (result != SQLITE_OK)
+        throw std::runtime_error {message};
+}
+} // namespace
+
+
+void configure(configuration const& config)
+{
+    switch (config.allocator)
+    {
+    case memory_allocator::SYSTEM:
+    {
+        break;
+    }
+    case memory_allocator::THREAD_CACHING:
+    {
+        static sqlite3_mem_methods const methods = {
+            &caching_malloc,
+            &caching_free,
+            &caching_realloc,
+            &caching_size,
+            &caching_roundup,
+            &caching_init,
+            &caching_shutdown,
+            nullptr,
+        };
+        check(sqlite3_config(SQLITE_CONFIG_MALLOC, &methods),
+              "Failed to configure sqlite allocator.");
+        break;
+    }
+    case memory_allocator::ARENA:
+    {
+        if (config.arena_size == 0 ||
+            config.arena_size >
+                static_cast<std::size_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error {"Invalid sqlite arena size."};
+
+        // sqlite keeps using the arena until the process exits
+        static std::unique_ptr<char[]> arena {};
+
+        auto buffer = std::make_unique<char[]>(config.arena_size);
+
+        check(sqlite3_config(SQLITE_CONFIG_HEAP,
+                             buffer.get(),
+                             static_cast<int>(config.arena_size),
+                             config.arena_min_alloc),
+              "Failed to configure sqlite arena, SQLITE_ENABLE_MEMSYS5 is "
+              "required.");
+
+        arena = std::move(buffer);
+        break;
+    }
+    default:
+    {
+        throw std::runtime_error {"Invalid sqlite allocator."};
+    }
+    }
+
+    if (config.lookaside_slot_size >= 0 && config.lookaside_slot_count >= 0)
+        check(sqlite3_config(SQLITE_CONFIG_LOOKASIDE,
+                             config.lookaside_slot_size,
+                             config.lookaside_slot_count),
+              "Failed to configure sqlite lookaside.");
+
+    if (config.page_cache_slot_size > 0 && config.page_cache_slot_count > 0)
+        check(sqlite3_config(SQLITE_CONFIG_PAGECACHE,
+                             nullptr,
+                             config.page_cache_slot_size,
+                             config.page_cache_slot_count),
+              "Failed to configure sqlite page cache.");
+
+    if (config.memstatus)
+        check(sqlite3_config(SQLITE_CONFIG_MEMSTATUS,
+                             *config.memstatus ? 1 : 0),
+              "Failed to configure sqlite memstatus.");
+
+    if (sqlite3_initialize() != SQLITE_OK)
+        throw std::runtime_error {"Failed to initialize sqlite."};
+}
+
+
+memory_statistics memory_stats(bool const& reset_highwater)
+{
+    memory_statistics stats {};
+    stats.memory_used  = status(SQLITE_STATUS_MEMORY_USED, reset_highwater);
+    stats.malloc_size  = status(SQLITE_STATUS_MALLOC_SIZE, reset_highwater);
+    stats.malloc_count = status(SQLITE_STATUS_MALLOC_COUNT, reset_highwater);
+    stats.page_cache_used =
+        status(SQLITE_STATUS_PAGECACHE_USED, reset_highwater);
+    stats.page_cache_overflow =
+        status(SQLITE_STATUS_PAGECACHE_OVERFLOW, reset_highwater);
+    stats.page_cache_size =
+        status(SQLITE_STATUS_PAGECACHE_SIZE, reset_highwater);
+    return stats;
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,83 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace mm
+{
+namespace sqlite
+{
+enum class memory_allocator
+{
+    SYSTEM         = 0,
+    THREAD_CACHING = 1,
+    ARENA          = 2,
+};
+
+
+struct configuration
+{
+    memory_allocator allocator = memory_allocator::SYSTEM;
+
+    // a fixed heap for ARENA, needs SQLITE_ENABLE_MEMSYS5
+    std::size_t arena_size      = 0;
+    int         arena_min_alloc = 0;
+
+    // default lookaside of every connection, negative keeps sqlite's
+    int lookaside_slot_size  = -1;
+    int lookaside_slot_count = -1;
+
+    // preallocated page cache slots, 0 disables
+    int page_cache_slot_size  = 0;
+    int page_cache_slot_count = 0;
+
+    std::optional<bool> memstatus = std::nullopt;
+};
+
+
+struct memory_status
+{
+    std::int64_t current   = 0;
+    std::int64_t highwater = 0;
+};
+
+
+struct memory_statistics
+{
+    memory_status memory_used         = {};
+    memory_status malloc_size         = {};
+    memory_status malloc_count        = {};
+    memory_status page_cache_used     = {};
+    memory_status page_cache_overflow = {};
+    memory_status page_cache_size     = {};
+};
+
+
+// must be called before sqlite is initialized, i.e. before the first
+// database is opened
+void configure(configuration const& config);
+
+// most counters stay 0 unless memstatus is enabled
+memory_statistics memory_stats(bool const& reset_highwater = false);
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,544 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <sqlite3.h>
+#include "function.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+template <typename Value>
+class table_field
+{
+public:
+    table_field() = delete;
+    ~table_field() = default;
+
+    // a data member pointer or any callable taking Value const&
+    template <typename Getter>
+    table_field(std::string const& name, Getter getter)
+        : m_name {name}
+        , m_result {[getter](sqlite3_context* context, Value const& value)
+                    {
+                        using result = std::decay_t<
+                            std::invoke_result_t<Getter const&, Value const&>>;
+                        detail::value_traits<result>::result(
+                            context, std::invoke(getter, value));
+                    }}
+    {
+    }
+
+    std::string const& name() const { return m_name; }
+
+    void result(sqlite3_context* context, Value const& value) const
+    {
+        m_result(context, value);
+    }
+
+
+private:
+    std::string                                          m_name;
+    std::function<void(sqlite3_context*, Value const&)> m_result;
+};
+
+
+namespace detail
+{
+template <typename T, typename = void>
+struct is_associative : std::false_type
+{
+};
+
+
+template <typename T>
+struct is_associative<
+    T,
+    std::void_t<typename T::key_type, typename T::mapped_type>>
+    : std::true_type
+{
+};
+
+
+template <typename T, typename = void>
+struct is_ordered : std::false_type
+{
+};
+
+
+template <typename T>
+struct is_ordered<T, std::void_t<typename T::key_compare>>
+    : std::bool_constant<
+          std::is_same_v<typename T::key_compare,
+                         std::less<typename T::key_type>> ||
+          std::is_same_v<typename T::key_compare, std::less<>>>
+{
+};
+
+
+// multimaps return a plain iterator from insert, sequences have unique
+// rowids
+template <typename T, typename = void>
+struct has_unique_keys : std::true_type
+{
+};
+
+
+template <typename T>
+struct has_unique_keys<T, std::enable_if_t<is_associative<T>::value>>
+    : std::bool_constant<!std::is_same_v<
+          decltype(std::declval<T&>().insert(
+              std::declval<typename T::value_type const&>())),
+          typename T::iterator>>
+{
+};
+
+
+template <typename Container, typename = void>
+struct container_value
+{
+    using type = typename Container::value_type;
+};
+
+
+template <typename Container>
+struct container_value<Container,
+                       std::enable_if_t<is_associative<Container>::value>>
+{
+    using type = typename Container::mapped_type;
+};
+
+
+template <typename Container>
+class container_module
+{
+public:
+    using value_type = typename container_value<Container>::type;
+    using iterator   = typename Container::const_iterator;
+
+    static constexpr bool associative = is_associative<Container>::value;
+    static constexpr bool ordered     = is_ordered<Container>::value;
+    static constexpr bool unique      = has_unique_keys<Container>::value;
+
+    static_assert(associative ||
+                      std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<
+                                            iterator>::iterator_category>,
+                  "Sequences must provide random access iterators.");
+
+    // idxNum bits of the constraints handled by xFilter, in argv order
+    static constexpr int EQ = 1;
+    static constexpr int GT = 2;
+    static constexpr int GE = 4;
+    static constexpr int LT = 8;
+    static constexpr int LE = 16;
+
+    container_module(Container const&                      data,
+                     std::vector<table_field<value_type>> const& fields,
+                     std::string const&                    key)
+        : m_data {data}
+        , m_fields {fields}
+        , m_key {key}
+    {
+    }
+
+    static sqlite3_module const* module()
+    {
+        // no xCreate makes the table eponymous-only
+        static sqlite3_module const instance = []()
+        {
+            sqlite3_module m {};
+            m.xConnect    = &connect;
+            m.xBestIndex  = &best_index;
+            m.xDisconnect = &disconnect;
+            m.xOpen       = &open;
+            m.xClose      = &close;
+            m.xFilter     = &filter;
+            m.xNext       = &next;
+            m.xEof        = &eof;
+            m.xColumn     = &column;
+            m.xRowid      = &rowid;
+            return m;
+        }();
+        return &instance;
+    }
+
+    static void destroy(void* pointer)
+    {
+        delete static_cast<container_module*>(pointer);
+    }
+
+
+private:
+    struct table : sqlite3_vtab
+    {
+        container_module const* module = nullptr;
+    };
+
+    struct cursor : sqlite3_vtab_cursor
+    {
+        iterator      current  = {};
+        iterator      end      = {};
+        sqlite3_int64 position = 0;
+    };
+
+    static container_module const& owner(sqlite3_vtab_cursor* base)
+    {
+        return *static_cast<table*>(base->pVtab)->module;
+    }
+
+    std::string schema() const
+    {
+        std::string sql = "CREATE TABLE x(";
+        if constexpr (associative)
+            sql += "\"" + m_key + "\", ";
+        for (auto const& field : m_fields)
+            sql += "\"" + field.name() + "\", ";
+        sql.resize(sql.size() - 2);
+        return sql + ")";
+    }
+
+    static int connect(sqlite3*            db,
+                       void*               context,
+                       int,
+                       char const* const*,
+                       sqlite3_vtab**      vtab,
+                       char**)
+    {
+        auto const* self = static_cast<container_module const*>(context);
+
+        int const result = sqlite3_declare_vtab(db, self->schema().c_str());
+        if (result != SQLITE_OK)
+            return result;
+
+        auto* t   = new table {};
+        t->module = self;
+        *vtab     = t;
+
+        sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+        return SQLITE_OK;
+    }
+
+    static int disconnect(sqlite3_vtab* vtab)
+    {
+        delete static_cast<table*>(vtab);
+        return SQLITE_OK;
+    }
+
+    static int best_index(sqlite3_vtab* vtab, sqlite3_index_info* info)
+    {
+        auto const& self = *static_cast<table*>(vtab)->module;
+
+        // the key is the map key (column 0), or the rowid (position) of
+        // sequences; ranges need ordered keys
+        int const key_column = associative ? 0 : -1;
+        bool const ranges    = !associative || ordered;
+
+        int eq = -1, lower = -1, upper = -1, plan = 0;
+
+        for (int i = 0; i < info->nConstraint; ++i)
+        {
+            auto const& c = info->aConstraint[i];
+
+            if (!c.usable || c.iColumn != key_column)
+                continue;
+
+            switch (c.op)
+            {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                eq = i;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_GT:
+            case SQLITE_INDEX_CONSTRAINT_GE:
+                if (ranges)
+                    lower = i;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_LT:
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                if (ranges)
+                    upper = i;
+                break;
+            default:
+                break;
+            }
+        }
+
+        auto const rows = static_cast<double>(self.m_data.size());
+        int argument    = 0;
+
+        // sqlite re-checks every constraint (omit stays 0), so a constraint
+        // xFilter cannot apply exactly only widens the scan
+        if (eq >= 0)
+        {
+            plan |= EQ;
+            info->aConstraintUsage[eq].argvIndex = ++argument;
+            info->estimatedCost                  = 1.0;
+            info->estimatedRows                  = 1;
+            if constexpr (unique)
+                info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+        }
+        else
+        {
+            if (lower >= 0)
+            {
+                plan |= info->aConstraint[lower].op ==
+                                SQLITE_INDEX_CONSTRAINT_GT
+                            ? GT
+                            : GE;
+                info->aConstraintUsage[lower].argvIndex = ++argument;
+            }
+
+            if (upper >= 0)
+            {
+                plan |= info->aConstraint[upper].op ==
+                                SQLITE_INDEX_CONSTRAINT_LT
+                            ? LT
+                            : LE;
+                info->aConstraintUsage[upper].argvIndex = ++argument;
+            }
+
+            double fraction = 1.0;
+            if (lower >= 0 && upper >= 0)
+                fraction = 0.1;
+            else if (lower >= 0 || upper >= 0)
+                fraction = 0.5;
+
+            info->estimatedCost = 1.0 + rows * fraction;
+            info->estimatedRows =
+                static_cast<sqlite3_int64>(1.0 + rows * fraction);
+        }
+
+        info->idxNum = plan;
+        return SQLITE_OK;
+    }
+
+    static int open(sqlite3_vtab*, sqlite3_vtab_cursor** base)
+    {
+        *base = new cursor {};
+        return SQLITE_OK;
+    }
+
+    static int close(sqlite3_vtab_cursor* base)
+    {
+        delete static_cast<cursor*>(base);
+        return SQLITE_OK;
+    }
+
+    template <typename Key>
+    static bool key_argument(sqlite3_value* value, Key& key)
+    {
+        int const type = sqlite3_value_type(value);
+
+        if constexpr (std::is_integral_v<Key>)
+        {
+            if (type != SQLITE_INTEGER)
+                return false;
+            using limits = std::numeric_limits<Key>;
+
+            auto const v = sqlite3_value_int64(value);
+            if (v < static_cast<sqlite3_int64>(limits::min()) ||
+                static_cast<sqlite3_uint64>(v) >
+                    static_cast<sqlite3_uint64>(limits::max()))
+                return false;
+            key = value_traits<Key>::get(value);
+            return true;
+        }
+        else if constexpr (std::is_floating_point_v<Key>)
+        {
+            if (type != SQLITE_INTEGER && type != SQLITE_FLOAT)
+                return false;
+            key = value_traits<Key>::get(value);
+            return true;
+        }
+        else
+        {
+            if (type != SQLITE_TEXT)
+                return false;
+            key = value_traits<Key>::get(value);
+            return true;
+        }
+    }
+
+    static int filter(sqlite3_vtab_cursor* base,
+                      int                  plan,
+                      char const*,
+                      int,
+                      sqlite3_value** argv)
+    {
+        auto&       cur  = *static_cast<cursor*>(base);
+        auto const& data = owner(base).m_data;
+
+        cur.current  = data.begin();
+        cur.end      = data.end();
+        cur.position = 0;
+
+        int argument = 0;
+
+        if constexpr (associative)
+        {
+            using key_type = typename Container::key_type;
+
+            key_type key {};
+
+            if (plan & EQ)
+            {
+                if (key_argument(argv[argument++], key))
+                {
+                    auto const range = data.equal_range(key);
+                    cur.current      = range.first;
+                    cur.end          = range.second;
+                }
+                return SQLITE_OK;
+            }
+
+            if constexpr (ordered)
+            {
+                if ((plan & (GT | GE)) && key_argument(argv[argument++], key))
+                    cur.current = plan & GT ? data.upper_bound(key)
+                                            : data.lower_bound(key);
+
+                if ((plan & (LT | LE)) && key_argument(argv[argument++], key))
+                    cur.end = plan & LT ? data.lower_bound(key)
+                                        : data.upper_bound(key);
+
+                // an empty range may leave end before current, or current
+                // past the last key while end is not
+                if (cur.current == data.end() ||
+                    (cur.end != data.end() &&
+                     data.key_comp()(cur.end->first, cur.current->first)))
+                    cur.end = cur.current;
+            }
+        }
+        else
+        {
+            // rowids of sequences are 1-based positions
+            auto const size  = static_cast<sqlite3_int64>(data.size());
+            sqlite3_int64 lo = 1, hi = size;
+
+            auto const bound = [&argv, &argument](sqlite3_int64& v)
+            {
+                sqlite3_value* value = argv[argument++];
+                if (sqlite3_value_type(value) != SQLITE_INTEGER)
+                    return false;
+                v = sqlite3_value_int64(value);
+                return true;
+            };
+
+            sqlite3_int64 v = 0;
+
+            if ((plan & EQ) && bound(v))
+                lo = hi = v;
+            // exclusive bounds at the limits of the rowid range are empty
+            constexpr auto max = std::numeric_limits<sqlite3_int64>::max();
+            constexpr auto min = std::numeric_limits<sqlite3_int64>::min();
+
+            if ((plan & (GT | GE)) && bound(v))
+                lo = plan & GT ? (v == max ? max : v + 1) : v;
+            if ((plan & (LT | LE)) && bound(v))
+                hi = plan & LT ? (v == min ? min : v - 1) : v;
+
+            lo = lo < 1 ? 1 : lo;
+            hi = hi > size ? size : hi;
+
+            if (lo > hi)
+            {
+                cur.current = cur.end;
+                return SQLITE_OK;
+            }
+
+            cur.current  = data.begin() + (lo - 1);
+            cur.end      = data.begin() + hi;
+            cur.position = lo - 1;
+        }
+
+        return SQLITE_OK;
+    }
+
+    static int next(sqlite3_vtab_cursor* base)
+    {
+        auto& cur = *static_cast<cursor*>(base);
+        ++cur.current;
+        ++cur.position;
+        return SQLITE_OK;
+    }
+
+    static int eof(sqlite3_vtab_cursor* base)
+    {
+        auto const& cur = *static_cast<cursor*>(base);
+        return cur.current == cur.end ? 1 : 0;
+    }
+
+    static int
+    column(sqlite3_vtab_cursor* base, sqlite3_context* context, int index)
+    {
+        auto const& cur    = *static_cast<cursor*>(base);
+        auto const& fields = owner(base).m_fields;
+
+        try
+        {
+            if constexpr (associative)
+            {
+                using key_type = std::decay_t<typename Container::key_type>;
+
+                if (index == 0)
+                    value_traits<key_type>::result(context, cur.current->first);
+                else
+                    fields[static_cast<std::size_t>(index - 1)].result(
+                        context, cur.current->second);
+            }
+            else
+            {
+                fields[static_cast<std::size_t>(index)].result(context,
+                                                               *cur.current);
+            }
+        }
+        catch (std::exception const& e)
+        {
+            sqlite3_result_error(context, e.what(), -1);
+        }
+        catch (...)
+        {
+            sqlite3_result_error(context, "Unknown exception.", -1);
+        }
+
+        return SQLITE_OK;
+    }
+
+    static int rowid(sqlite3_vtab_cursor* base, sqlite3_int64* id)
+    {
+        *id = static_cast<cursor*>(base)->position + 1;
+        return SQLITE_OK;
+    }
+
+    Container const&                     m_data;
+    std::vector<table_field<value_type>> m_fields;
+    std::string                          m_key;
+};
+} // namespace detail
+} // namespace sqlite
+} // namespace mm
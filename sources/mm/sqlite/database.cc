@@ -19,12 +19,147 @@
 
 #include "database.hh"
 #include "statement.hh"
+#include <atomic>
+#include <thread>
 #include <stdexcept>
 
+#ifndef SQLITE_DEFAULT_WAL_AUTOCHECKPOINT
+#define SQLITE_DEFAULT_WAL_AUTOCHECKPOINT 1000
+#endif
+
 namespace mm
 {
 namespace sqlite
 {
+struct database::busy_context
+{
+    busy_policy                           policy  = {};
+    std::chrono::steady_clock::time_point started = {};
+    std::atomic<std::uint64_t>            retries = {0};
+
+    static int handler(void* context, int count)
+    {
+        auto* busy = static_cast<busy_context*>(context);
+
+        auto const now = std::chrono::steady_clock::now();
+
+        // sqlite restarts the count for every new lock attempt
+        if (count == 0)
+            busy->started = now;
+
+        auto const elapsed = now - busy->started;
+
+        if (elapsed >= busy->policy.timeout())
+            return 0;
+
+        auto const remaining = busy->policy.timeout() - elapsed;
+        auto const delay     = busy->policy.delay(count);
+
+        busy->retries.fetch_add(1, std::memory_order_relaxed);
+
+        if (delay < remaining)
+            std::this_thread::sleep_for(delay);
+        else
+            std::this_thread::sleep_for(remaining);
+
+        return 1;
+    }
+};
+
+
+struct database::hooks_context
+{
+    update_callback    update     = {};
+    commit_callback    commit     = {};
+    committed_callback committed  = {};
+    rollback_callback  rollback   = {};
+    wal_callback       wal        = {};
+    bool               wal_set    = false;
+    bool               committing = false;
+    result_cache*      cache      = nullptr;
+
+    // exceptions must not unwind through sqlite
+    static void on_update(void*         context,
+                          int           operation,
+                          char const*   database_name,
+                          char const*   table,
+                          sqlite3_int64 rowid)
+    {
+        auto const* hooks = static_cast<hooks_context const*>(context);
+        try
+        {
+            if (hooks->cache)
+                hooks->cache->invalidate(table);
+            if (hooks->update)
+                hooks->update(static_cast<change_type>(operation),
+                              database_name,
+                              table,
+                              rowid);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    static int on_commit(void* context)
+    {
+        auto* hooks = static_cast<hooks_context*>(context);
+        try
+        {
+            if (hooks->commit && !hooks->commit())
+                return 1;
+        }
+        catch (...)
+        {
+            return 1;
+        }
+        hooks->committing = static_cast<bool>(hooks->committed);
+        return 0;
+    }
+
+    static void on_rollback(void* context)
+    {
+        auto* hooks       = static_cast<hooks_context*>(context);
+        hooks->committing = false;
+        try
+        {
+            if (hooks->rollback)
+                hooks->rollback();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    static int on_wal(void* context,
+                      sqlite3*,
+                      char const* database_name,
+                      int         pages)
+    {
+        auto const* hooks = static_cast<hooks_context const*>(context);
+        try
+        {
+            hooks->wal(database_name, pages);
+        }
+        catch (...)
+        {
+        }
+        return SQLITE_OK;
+    }
+
+    // the commit hook runs before the commit is durable, committed
+    // callbacks wait until the connection is back in autocommit mode
+    void completed(sqlite3* db)
+    {
+        if (!committing || !sqlite3_get_autocommit(db))
+            return;
+        committing = false;
+        if (committed)
+            committed();
+    }
+};
+
+
 database::database() = default;
 
 
@@ -60,15 +195,63 @@ void database::open(std::string const& path, int const& flags)
     }
 
     m_sqlite.reset(sqlite_ptr, _close);
+
+    apply_busy_timeout();
+    apply_hooks();
 }
 
 
-void database::close() { m_sqlite.reset(); }
+void database::open_readonly(std::string const&              path,
+                             warmup_mode const&              mode,
+                             std::vector<std::string> const& objects)
+{
+    open(path, SQLITE_OPEN_READONLY);
+
+    try
+    {
+        auto const pages = execute("PRAGMA page_count");
+        auto const size  = execute("PRAGMA page_size");
+
+        execute("PRAGMA mmap_size = " +
+                std::to_string(
+                    std::stoll(pages.at(0).columns().at("page_count").value()) *
+                    std::stoll(size.at(0).columns().at("page_size").value())));
+
+        if (mode != warmup_mode::NONE)
+            m_warmup = std::make_shared<warmup>(path, mode, objects);
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+
+warmup::progress database::warmup_progress() const
+{
+    if (m_warmup)
+        return m_warmup->status();
+
+    warmup::progress result {};
+    result.finished = true;
+    return result;
+}
+
+
+void database::close()
+{
+    m_warmup.reset();
+    m_sqlite.reset();
+}
 
 
 bool database::opened() const { return m_sqlite != nullptr; }
 
 
+sqlite3* database::handle() const { return m_sqlite.get(); }
+
+
 std::vector<row> database::execute(std::string const& sql_)
 {
     return execute(sql_, {});
@@ -79,9 +262,59 @@ std::vector<row> database::execute(std::string const& sql_, row const& row_)
 {
     if (!opened())
         throw std::runtime_error {"Database is not opened."};
+
+    // results read inside a transaction may not be committed yet
+    bool const cached = m_cache && sqlite3_get_autocommit(m_sqlite.get());
+
+    std::string key {};
+
+    if (cached)
+    {
+        key = result_cache::key(sql_, row_);
+        if (auto rows = m_cache->find(key))
+            return std::move(*rows);
+    }
+
+    statement stmt {m_sqlite};
+    stmt.logging(m_logging);
+    stmt.cancellation(m_cancellation);
+    stmt.watchdog(m_watchdog);
+    stmt.metrics(m_metrics);
+    stmt.track_dependencies(m_cache != nullptr);
+    stmt.cache(m_cache);
+    stmt.completion(completion());
+    if (m_timeout.count() > 0)
+        stmt.timeout(m_timeout);
+
+    std::vector<row> results = stmt.execute(sql_, row_);
+
+    if (cached && stmt.readonly() && deterministic(stmt) &&
+        sqlite3_get_autocommit(m_sqlite.get()))
+        m_cache->insert(key, results, stmt.read_tables());
+
+    return results;
+}
+
+
+statement database::prepare(std::string const& sql_, row const& row_)
+{
+    if (!opened())
+        throw std::runtime_error {"Database is not opened."};
+
     statement stmt {m_sqlite};
     stmt.logging(m_logging);
-    return stmt.execute(sql_, row_);
+    stmt.cancellation(m_cancellation);
+    stmt.watchdog(m_watchdog);
+    stmt.metrics(m_metrics);
+    stmt.track_dependencies(m_cache != nullptr);
+    stmt.cache(m_cache);
+    stmt.completion(completion());
+    if (m_timeout.count() > 0)
+        stmt.timeout(m_timeout);
+
+    stmt.prepare(sql_);
+    stmt.bind(row_);
+    return stmt;
 }
 
 
@@ -89,5 +322,314 @@ void database::logging(bool const& enable) { m_logging = enable; }
 
 
 bool database::logging() const { return m_logging; }
+
+
+void database::interrupt() const
+{
+    if (m_sqlite)
+        sqlite3_interrupt(m_sqlite.get());
+}
+
+
+void database::timeout(std::chrono::milliseconds const& timeout_)
+{
+    if (timeout_.count() < 0)
+        throw std::runtime_error {"Invalid timeout."};
+    m_timeout = timeout_;
+}
+
+
+std::chrono::milliseconds const& database::timeout() const { return m_timeout; }
+
+
+void database::cancellation(std::optional<cancellation_token> const& token)
+{
+    m_cancellation = token;
+}
+
+
+std::optional<cancellation_token> const& database::cancellation() const
+{
+    return m_cancellation;
+}
+
+
+void database::watchdog(std::optional<scan_watchdog> const& watchdog_)
+{
+    m_watchdog = watchdog_;
+}
+
+
+std::optional<scan_watchdog> const& database::watchdog() const
+{
+    return m_watchdog;
+}
+
+
+std::vector<plan_node> database::query_plan(std::string const& sql_) const
+{
+    if (!opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    statement stmt {m_sqlite};
+    stmt.logging(m_logging);
+    stmt.prepare(sql_);
+    return stmt.query_plan();
+}
+
+
+void database::metrics(bool const& enable)
+{
+    if (!enable)
+        m_metrics.reset();
+    else if (!m_metrics)
+        m_metrics = std::make_shared<metrics_registry>();
+}
+
+
+bool database::metrics() const { return m_metrics != nullptr; }
+
+
+metrics_registry::snapshot database::metrics_snapshot() const
+{
+    metrics_registry::snapshot result =
+        m_metrics ? m_metrics->take() : metrics_registry::snapshot {};
+
+    result.busy_retries = busy_retries();
+
+    if (m_cache)
+    {
+        auto const stats    = m_cache->stats();
+        result.cache_hits   = stats.hits;
+        result.cache_misses = stats.misses;
+    }
+
+    if (!m_sqlite)
+        return result;
+
+    auto const sample = [this](int const& operation, bool const& highwater)
+    {
+        int current = 0;
+        int peak    = 0;
+        sqlite3_db_status(m_sqlite.get(), operation, &current, &peak, 0);
+        return static_cast<std::int64_t>(highwater ? peak : current);
+    };
+
+    auto& c               = result.connection;
+    c.cache_used          = sample(SQLITE_DBSTATUS_CACHE_USED, false);
+    c.cache_hit           = sample(SQLITE_DBSTATUS_CACHE_HIT, false);
+    c.cache_miss          = sample(SQLITE_DBSTATUS_CACHE_MISS, false);
+    c.cache_write         = sample(SQLITE_DBSTATUS_CACHE_WRITE, false);
+    c.cache_spill         = sample(SQLITE_DBSTATUS_CACHE_SPILL, false);
+    c.lookaside_used      = sample(SQLITE_DBSTATUS_LOOKASIDE_USED, false);
+    c.lookaside_hit       = sample(SQLITE_DBSTATUS_LOOKASIDE_HIT, true);
+    c.lookaside_miss_size = sample(SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, true);
+    c.lookaside_miss_full = sample(SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, true);
+    c.schema_used         = sample(SQLITE_DBSTATUS_SCHEMA_USED, false);
+    c.statement_used      = sample(SQLITE_DBSTATUS_STMT_USED, false);
+
+    return result;
+}
+
+
+std::string database::metrics_text(std::string const& prefix) const
+{
+    return metrics_registry::prometheus(metrics_snapshot(), prefix);
+}
+
+
+void database::busy_timeout(busy_policy const& policy)
+{
+    if (!m_busy)
+        m_busy = std::make_shared<busy_context>();
+    m_busy->policy = policy;
+    apply_busy_timeout();
+}
+
+
+busy_policy database::busy_timeout() const
+{
+    return m_busy ? m_busy->policy : busy_policy {};
+}
+
+
+std::uint64_t database::busy_retries() const
+{
+    return m_busy ? m_busy->retries.load(std::memory_order_relaxed) : 0;
+}
+
+
+void database::apply_busy_timeout() const
+{
+    if (!m_sqlite || !m_busy)
+        return;
+
+    int const result =
+        m_busy->policy.timeout().count() > 0
+            ? sqlite3_busy_handler(
+                  m_sqlite.get(), &busy_context::handler, m_busy.get())
+            : sqlite3_busy_handler(m_sqlite.get(), nullptr, nullptr);
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to set sqlite busy handler."};
+}
+
+
+void database::update_hook(update_callback const& callback)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+    m_hooks->update = callback;
+    apply_hooks();
+}
+
+
+void database::commit_hook(commit_callback const& callback)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+    m_hooks->commit = callback;
+    apply_hooks();
+}
+
+
+void database::committed_hook(committed_callback const& callback)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+    m_hooks->committed  = callback;
+    m_hooks->committing = false;
+    apply_hooks();
+}
+
+
+void database::rollback_hook(rollback_callback const& callback)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+    m_hooks->rollback = callback;
+    apply_hooks();
+}
+
+
+void database::wal_hook(wal_callback const& callback)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+    m_hooks->wal = callback;
+    apply_hooks();
+}
+
+
+void database::cache(std::size_t const& budget)
+{
+    if (!m_hooks)
+        m_hooks = std::make_shared<hooks_context>();
+
+    if (!budget)
+        m_cache.reset();
+    else if (!m_cache)
+        m_cache = std::make_shared<result_cache>(budget);
+    else
+        m_cache->budget(budget);
+
+    m_hooks->cache = m_cache.get();
+    apply_hooks();
+}
+
+
+std::size_t database::cache() const { return m_cache ? m_cache->budget() : 0; }
+
+
+result_cache::statistics database::cache_statistics() const
+{
+    return m_cache ? m_cache->stats() : result_cache::statistics {};
+}
+
+
+void database::clear_cache()
+{
+    if (m_cache)
+        m_cache->clear();
+}
+
+
+void database::invalidate_cache(std::string const& table)
+{
+    if (m_cache)
+        m_cache->invalidate(table);
+}
+
+
+void database::written(std::set<std::string> const& tables) const
+{
+    if (m_cache)
+        for (auto const& table : tables)
+            m_cache->invalidate(table);
+
+    if (m_hooks && m_sqlite)
+        m_hooks->completed(m_sqlite.get());
+}
+
+
+bool database::deterministic(statement const& stmt) const
+{
+    if (!stmt.deterministic())
+        return false;
+
+    for (auto const& v : stmt.functions())
+        if (m_volatile_functions.count(v))
+            return false;
+
+    return true;
+}
+
+
+std::function<void()> database::completion() const
+{
+    if (!m_hooks || !m_hooks->committed)
+        return {};
+
+    // statements may outlive the database, the hooks are only observed
+    return [hooks = std::weak_ptr<hooks_context> {m_hooks},
+            db    = m_sqlite.get()]()
+    {
+        if (auto const hooks_ = hooks.lock())
+            hooks_->completed(db);
+    };
+}
+
+
+void database::apply_hooks() const
+{
+    if (!m_sqlite || !m_hooks)
+        return;
+
+    sqlite3* const db      = m_sqlite.get();
+    void* const    context = m_hooks.get();
+
+    sqlite3_update_hook(db,
+                        m_hooks->update || m_hooks->cache
+                            ? &hooks_context::on_update
+                            : nullptr,
+                        context);
+    sqlite3_commit_hook(db,
+                        m_hooks->commit || m_hooks->committed
+                            ? &hooks_context::on_commit
+                            : nullptr,
+                        context);
+    sqlite3_rollback_hook(db,
+                          m_hooks->rollback || m_hooks->committed
+                              ? &hooks_context::on_rollback
+                              : nullptr,
+                          context);
+
+    if (m_hooks->wal)
+        sqlite3_wal_hook(db, &hooks_context::on_wal, context);
+    else if (m_hooks->wal_set)
+        sqlite3_wal_autocheckpoint(db, SQLITE_DEFAULT_WAL_AUTOCHECKPOINT);
+
+    m_hooks->wal_set = static_cast<bool>(m_hooks->wal);
+}
 } // namespace sqlite
 } // namespace mm
@@ -22,8 +22,26 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <set>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include <stdexcept>
 #include <sqlite3.h>
+#include "enums.hh"
+#include "function.hh"
+#include "container_table.hh"
 #include "row.hh"
+#include "statement.hh"
+#include "utilities.hh"
+#include "busy_policy.hh"
+#include "cancellation.hh"
+#include "result_cache.hh"
+#include "query_plan.hh"
+#include "warmup.hh"
+#include "metrics.hh"
 
 namespace mm
 {
@@ -32,25 +50,245 @@ namespace sqlite
 class database
 {
 public:
+    using update_callback   = std::function<void(change_type const&,
+                                               std::string_view const&,
+                                               std::string_view const&,
+                                               sqlite3_int64 const&)>;
+    using commit_callback    = std::function<bool()>;
+    using committed_callback = std::function<void()>;
+    using rollback_callback  = std::function<void()>;
+    using wal_callback =
+        std::function<void(std::string_view const&, int const&)>;
+
     database();
     ~database();
 
     database(std::string const& path, int const& flags);
 
     void open(std::string const& path, int const& flags);
+
+    // opens read-only with the whole file memory mapped, as far as
+    // SQLITE_MAX_MMAP_SIZE allows, and optionally warms the file up;
+    // objects name the tables and indexes to scan, all of them by default
+    void open_readonly(std::string const&              path,
+                       warmup_mode const&              mode = warmup_mode::NONE,
+                       std::vector<std::string> const& objects = {});
+    warmup::progress warmup_progress() const;
+
     void close();
     bool opened() const;
 
+    sqlite3* handle() const;
+
     std::vector<row> execute(std::string const& sql_);
     std::vector<row> execute(std::string const& sql_, row const& row_);
 
+    // prepared and bound like execute(), for stepping through rows one at
+    // a time; the statement bypasses the result cache and stops working
+    // once the database is closed
+    statement prepare(std::string const& sql_, row const& row_ = {});
+
     void logging(bool const& enable);
     bool logging() const;
 
+    void interrupt() const;
+
+    void timeout(std::chrono::milliseconds const& timeout_);
+    std::chrono::milliseconds const& timeout() const;
+
+    void cancellation(std::optional<cancellation_token> const& token);
+    std::optional<cancellation_token> const& cancellation() const;
+
+    // statements run through execute() and prepare() report full scans and
+    // automatic indexes to the watchdog
+    void watchdog(std::optional<scan_watchdog> const& watchdog_);
+    std::optional<scan_watchdog> const& watchdog() const;
+
+    std::vector<plan_node> query_plan(std::string const& sql_) const;
+
+    // counters and latency histograms of statements run through execute()
+    // and prepare(), snapshots add busy retries, result cache hits and
+    // sqlite3_db_status values
+    void                       metrics(bool const& enable);
+    bool                       metrics() const;
+    metrics_registry::snapshot metrics_snapshot() const;
+    std::string metrics_text(std::string const& prefix = "mmsqlite") const;
+
+    void          busy_timeout(busy_policy const& policy);
+    busy_policy   busy_timeout() const;
+    std::uint64_t busy_retries() const;
+
+    // callbacks run inside sqlite, they must not use this connection;
+    // returning false from or throwing in the commit callback turns the
+    // commit into a rollback, exceptions of the other callbacks are dropped,
+    // and installing a wal callback replaces auto-checkpointing
+    void update_hook(update_callback const& callback);
+    void commit_hook(commit_callback const& callback);
+    void rollback_hook(rollback_callback const& callback);
+    void wal_hook(wal_callback const& callback);
+
+    // runs outside sqlite once a commit is durable, when execute() or a step
+    // of a prepare()d statement returns in autocommit mode; the callback may
+    // use this connection and its exceptions reach the caller
+    void committed_hook(committed_callback const& callback);
+
+    // read-through cache for execute(), a budget of 0 disables it; writes
+    // through execute(), prepare() and the loaders invalidate entries, other
+    // writes on handle() only through the update hook, which misses WITHOUT
+    // ROWID tables, and writes of other connections not at all
+    void                     cache(std::size_t const& budget);
+    std::size_t              cache() const;
+    result_cache::statistics cache_statistics() const;
+    void                     clear_cache();
+    void                     invalidate_cache(std::string const& table);
+
+    // for writes made on handle(): invalidates the written tables in the
+    // result cache and runs the committed callback of a completed commit
+    void written(std::set<std::string> const& tables) const;
+
+    // flags may combine SQLITE_DETERMINISTIC, SQLITE_INNOCUOUS and
+    // SQLITE_DIRECTONLY; functions are lost when the database is closed
+    template <typename Function>
+    void create_function(std::string const& name,
+                         Function&&         function,
+                         int const&         flags = 0);
+
+    // every group aggregates into a copy of the prototype through
+    // step(arguments...) and produces its value through finalize()
+    template <typename Aggregate>
+    void create_aggregate(std::string const& name,
+                          Aggregate const&   prototype = Aggregate {},
+                          int const&         flags     = 0);
+
+    // exposes a random access sequence or a map of values as a read-only
+    // eponymous virtual table, without copying; the container must outlive
+    // the connection and must not change while it is queried.
+    // equality and range constraints on the rowid (1-based position) of
+    // sequences or on the key column of maps are served directly
+    template <typename Container>
+    void create_container_table(
+        std::string const& name,
+        Container const&   data,
+        std::vector<table_field<
+            typename detail::container_value<Container>::type>> const& fields,
+        std::string const& key = "key");
+
 
 private:
-    std::shared_ptr<sqlite3> m_sqlite;
-    bool                     m_logging = false;
+    struct busy_context;
+    struct hooks_context;
+
+    void                  apply_busy_timeout() const;
+    void                  apply_hooks() const;
+    std::function<void()> completion() const;
+    bool                  deterministic(statement const& stmt) const;
+
+    std::shared_ptr<sqlite3>          m_sqlite;
+    bool                              m_logging            = false;
+    std::chrono::milliseconds         m_timeout            = {};
+    std::optional<cancellation_token> m_cancellation       = {};
+    std::shared_ptr<busy_context>     m_busy               = {};
+    std::shared_ptr<hooks_context>    m_hooks              = {};
+    std::shared_ptr<result_cache>     m_cache              = {};
+    std::set<std::string>             m_volatile_functions = {};
+    std::optional<scan_watchdog>      m_watchdog           = {};
+    std::shared_ptr<warmup>           m_warmup             = {};
+    std::shared_ptr<metrics_registry> m_metrics            = {};
 };
+
+
+template <typename Function>
+void database::create_function(std::string const& name,
+                               Function&&         function,
+                               int const&         flags)
+{
+    using function_type = std::decay_t<Function>;
+
+    if (!opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    // sqlite invokes the destructor itself if the registration fails
+    int const result = sqlite3_create_function_v2(
+        m_sqlite.get(),
+        name.c_str(),
+        detail::argument_count<function_type>(),
+        SQLITE_UTF8 | flags,
+        new function_type {std::forward<Function>(function)},
+        &detail::scalar<function_type>,
+        nullptr,
+        nullptr,
+        &detail::destroy<function_type>);
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to create sqlite function."};
+
+    if (!(flags & SQLITE_DETERMINISTIC))
+        m_volatile_functions.insert(name);
+    else
+        m_volatile_functions.erase(name);
+}
+
+
+template <typename Aggregate>
+void database::create_aggregate(std::string const& name,
+                                Aggregate const&   prototype,
+                                int const&         flags)
+{
+    if (!opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    int const result = sqlite3_create_function_v2(
+        m_sqlite.get(),
+        name.c_str(),
+        detail::argument_count<decltype(&Aggregate::step)>(),
+        SQLITE_UTF8 | flags,
+        new Aggregate {prototype},
+        nullptr,
+        &detail::aggregate_step<Aggregate>,
+        &detail::aggregate_final<Aggregate>,
+        &detail::destroy<Aggregate>);
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to create sqlite aggregate."};
+
+    if (!(flags & SQLITE_DETERMINISTIC))
+        m_volatile_functions.insert(name);
+    else
+        m_volatile_functions.erase(name);
+}
+
+
+template <typename Container>
+void database::create_container_table(
+    std::string const& name,
+    Container const&   data,
+    std::vector<table_field<
+        typename detail::container_value<Container>::type>> const& fields,
+    std::string const& key)
+{
+    using module_type = detail::container_module<Container>;
+
+    if (!opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    valid_sqlite_identifier(name);
+    valid_sqlite_identifier(key);
+    for (auto const& field : fields)
+        valid_sqlite_identifier(field.name());
+
+    if (fields.empty())
+        throw std::runtime_error {"Container table without fields."};
+
+    // sqlite invokes the destructor itself if the registration fails
+    int const result =
+        sqlite3_create_module_v2(m_sqlite.get(),
+                                 name.c_str(),
+                                 module_type::module(),
+                                 new module_type {data, fields, key},
+                                 &module_type::destroy);
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to create sqlite module."};
+}
 } // namespace sqlite
 } // namespace mm
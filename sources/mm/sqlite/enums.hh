@@ -21,6 +21,7 @@
 
 #include <string>
 #include <stdexcept>
+#include <sqlite3.h>
 
 namespace mm
 {
@@ -33,5 +34,58 @@ enum class data_type
     REAL    = 2,
     TEXT    = 3,
 };
+
+
+enum class change_type
+{
+    INSERT = SQLITE_INSERT,
+    UPDATE = SQLITE_UPDATE,
+    DELETE = SQLITE_DELETE,
+};
+
+
+enum class file_format
+{
+    CSV    = 0,
+    NDJSON = 1,
+};
+
+
+enum class conflict_type
+{
+    DATA        = 1,
+    NOTFOUND    = 2,
+    CONFLICT    = 3,
+    CONSTRAINT  = 4,
+    FOREIGN_KEY = 5,
+};
+
+
+enum class conflict_action
+{
+    OMIT    = 0,
+    REPLACE = 1,
+    ABORT   = 2,
+};
+
+
+enum class warmup_mode
+{
+    NONE       = 0,
+    WILLNEED   = 1,
+    SEQUENTIAL = 2,
+};
+
+
+enum class statement_status
+{
+    FULLSCAN_STEP = SQLITE_STMTSTATUS_FULLSCAN_STEP,
+    SORT          = SQLITE_STMTSTATUS_SORT,
+    AUTOINDEX     = SQLITE_STMTSTATUS_AUTOINDEX,
+    VM_STEP       = SQLITE_STMTSTATUS_VM_STEP,
+    REPREPARE     = SQLITE_STMTSTATUS_REPREPARE,
+    RUN           = SQLITE_STMTSTATUS_RUN,
+    MEMUSED       = SQLITE_STMTSTATUS_MEMUSED,
+};
 } // namespace sqlite
 } // namespace mm
@@ -0,0 +1,49 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+class interrupt_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+
+class timeout_error : public interrupt_error
+{
+public:
+    using interrupt_error::interrupt_error;
+};
+
+
+class busy_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,334 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "fulltext_index.hh"
+#include "utilities.hh"
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+std::string column_list(std::vector<std::string> const& columns,
+                        std::string const&              qualifier)
+{
+    std::string result {};
+    for (auto const& v : columns)
+    {
+        result.append(", ");
+        result.append(qualifier);
+        result.append(quote_identifier(v));
+    }
+    return result;
+}
+
+
+std::string joined_queries(std::vector<std::string> const& queries,
+                           std::string const&              separator)
+{
+    if (queries.empty())
+        throw std::runtime_error {"Empty full-text query."};
+
+    std::string result {};
+    for (auto const& v : queries)
+    {
+        if (!result.empty())
+            result.append(separator);
+        result.append(1, '(');
+        result.append(v);
+        result.append(1, ')');
+    }
+    return result;
+}
+
+
+std::string literal(std::string const& text)
+{
+    std::string result = "'";
+    for (char const v : text)
+    {
+        if (v == '\'')
+            result += '\'';
+        result += v;
+    }
+    return result + "'";
+}
+} // namespace
+
+
+fulltext_index::~fulltext_index() = default;
+
+
+fulltext_index::fulltext_index(database&                       database_,
+                               std::string const&              table,
+                               std::vector<std::string> const& columns,
+                               std::string const&              name,
+                               std::string const&              tokenizer)
+    : m_database {database_}
+    , m_table {table}
+    , m_columns {columns}
+    , m_name {name.empty() ? table + "_fts" : name}
+    , m_tokenizer {tokenizer}
+{
+    valid_sqlite_identifier(m_table);
+    valid_sqlite_identifier(m_name);
+    for (auto const& v : m_columns)
+        valid_sqlite_identifier(v);
+
+    if (m_columns.empty())
+        throw std::runtime_error {"Full-text index without columns."};
+}
+
+
+std::string const& fulltext_index::name() const { return m_name; }
+
+
+void fulltext_index::create()
+{
+    std::string const index   = quote_identifier(m_name);
+    std::string const table   = quote_identifier(m_table);
+    std::string const columns = column_list(m_columns, "");
+
+    std::string const old_values = "'delete', old.rowid" +
+                                   column_list(m_columns, "old.");
+    std::string const new_values = "new.rowid" + column_list(m_columns, "new.");
+
+    std::string update_of {};
+    for (auto const& v : m_columns)
+    {
+        if (!update_of.empty())
+            update_of.append(", ");
+        update_of.append(quote_identifier(v));
+    }
+
+    m_database.execute("CREATE VIRTUAL TABLE IF NOT EXISTS " + index +
+                       " USING fts5(" + columns.substr(2) +
+                       ", content=" + literal(m_table) +
+                       ", content_rowid='rowid', tokenize=" +
+                       literal(m_tokenizer) + ")");
+
+    m_database.execute("CREATE TRIGGER IF NOT EXISTS " +
+                       quote_identifier(m_name + "_insert") +
+                       " AFTER INSERT ON " + table + " BEGIN INSERT INTO " +
+                       index + " (rowid" + columns + ") VALUES (" +
+                       new_values + "); END");
+
+    m_database.execute("CREATE TRIGGER IF NOT EXISTS " +
+                       quote_identifier(m_name + "_delete") +
+                       " AFTER DELETE ON " + table + " BEGIN INSERT INTO " +
+                       index + " (" + index + ", rowid" + columns +
+                       ") VALUES (" + old_values + "); END");
+
+    m_database.execute("CREATE TRIGGER IF NOT EXISTS " +
+                       quote_identifier(m_name + "_update") +
+                       " AFTER UPDATE OF " + update_of + " ON " + table +
+                       " BEGIN INSERT INTO " + index + " (" + index +
+                       ", rowid" + columns + ") VALUES (" + old_values +
+                       "); INSERT INTO " + index + " (rowid" + columns +
+                       ") VALUES (" + new_values + "); END");
+}
+
+
+void fulltext_index::drop()
+{
+    for (auto const& v : {"_insert", "_delete", "_update"})
+        m_database.execute("DROP TRIGGER IF EXISTS " +
+                           quote_identifier(m_name + v));
+    m_database.execute("DROP TABLE IF EXISTS " + quote_identifier(m_name));
+}
+
+
+void fulltext_index::rebuild()
+{
+    bool const transaction = sqlite3_get_autocommit(m_database.handle()) != 0;
+
+    if (transaction)
+        m_database.execute("BEGIN");
+
+    try
+    {
+        m_database.execute("INSERT INTO " + quote_identifier(m_name) + " (" +
+                           quote_identifier(m_name) + ") VALUES ('rebuild')");
+        if (transaction)
+            m_database.execute("COMMIT");
+    }
+    catch (...)
+    {
+        try
+        {
+            if (transaction)
+                m_database.execute("ROLLBACK");
+        }
+        catch (...)
+        {
+        }
+        throw;
+    }
+}
+
+
+void fulltext_index::optimize()
+{
+    m_database.execute("INSERT INTO " + quote_identifier(m_name) + " (" +
+                       quote_identifier(m_name) + ") VALUES ('optimize')");
+}
+
+
+void fulltext_index::weights(std::vector<double> const& weights_)
+{
+    // the classic locale keeps the decimal point independent of the user's
+    std::ostringstream ranking {};
+    ranking.imbue(std::locale::classic());
+    ranking.precision(std::numeric_limits<double>::max_digits10);
+    ranking << "bm25(";
+    for (std::size_t i = 0; i < weights_.size(); ++i)
+        ranking << (i ? ", " : "") << weights_[i];
+    ranking << ")";
+
+    // kept in the index configuration, ORDER BY rank uses it
+    m_database.execute("INSERT INTO " + quote_identifier(m_name) + " (" +
+                       quote_identifier(m_name) + ", rank) VALUES ('rank', " +
+                       literal(ranking.str()) + ")");
+}
+
+
+statement fulltext_index::search(std::string const& query,
+                                 int const&         limit,
+                                 int const&         offset) const
+{
+    row parameters {"query", column {query, "query"}};
+    if (limit > 0)
+    {
+        parameters.append("limit", column {limit, "limit"});
+        parameters.append("offset", column {offset, "offset"});
+    }
+    return m_database.prepare(search_sql(limit > 0), parameters);
+}
+
+
+std::vector<row> fulltext_index::search_rows(std::string const& query,
+                                             int const&         limit,
+                                             int const&         offset) const
+{
+    statement stmt = search(query, limit, offset);
+
+    std::vector<row> results = {};
+    while (true)
+    {
+        stmt.step();
+        if (!stmt.has_row())
+            break;
+        results.push_back(stmt.get_row());
+    }
+    return results;
+}
+
+
+std::size_t fulltext_index::count(std::string const& query) const
+{
+    auto const results =
+        m_database.execute("SELECT count(*) AS c FROM " +
+                               quote_identifier(m_name) + " WHERE " +
+                               quote_identifier(m_name) + " MATCH :query",
+                           row {"query", column {query, "query"}});
+    return static_cast<std::size_t>(
+        std::stoull(results.at(0).columns().at("c").value()));
+}
+
+
+std::string fulltext_index::term(std::string const& text)
+{
+    std::string result = "\"";
+    for (char const v : text)
+    {
+        if (v == '"')
+            result += '"';
+        result += v;
+    }
+    return result + "\"";
+}
+
+
+std::string fulltext_index::prefix(std::string const& text)
+{
+    return term(text) + " *";
+}
+
+
+std::string fulltext_index::all_of(std::vector<std::string> const& queries)
+{
+    return joined_queries(queries, " AND ");
+}
+
+
+std::string fulltext_index::any_of(std::vector<std::string> const& queries)
+{
+    return joined_queries(queries, " OR ");
+}
+
+
+std::string fulltext_index::near(std::vector<std::string> const& terms,
+                                 int const&                      distance)
+{
+    if (terms.empty())
+        throw std::runtime_error {"Empty full-text query."};
+
+    std::string result = "NEAR(";
+    for (auto const& v : terms)
+    {
+        result.append(term(v));
+        result.append(1, ' ');
+    }
+    result.append(", ");
+    result.append(std::to_string(distance));
+    result.append(1, ')');
+    return result;
+}
+
+
+std::string fulltext_index::in_column(std::string const& column_,
+                                      std::string const& query)
+{
+    valid_sqlite_identifier(column_);
+    return column_ + " : (" + query + ")";
+}
+
+
+std::string fulltext_index::search_sql(bool const& limited) const
+{
+    std::string const index = quote_identifier(m_name);
+    std::string const table = quote_identifier(m_table);
+
+    std::string sql = "SELECT " + table + ".*, " + index +
+                      ".rank AS score FROM " + index + " JOIN " + table +
+                      " ON " + table + ".rowid = " + index + ".rowid WHERE " +
+                      index + " MATCH :query ORDER BY " + index + ".rank";
+
+    if (limited)
+        sql += " LIMIT :limit OFFSET :offset";
+
+    return sql;
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,98 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "row.hh"
+#include "database.hh"
+#include "statement.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// an external-content FTS5 index over text columns of a rowid table, kept
+// in sync by insert, delete and update triggers; the index stores no copy
+// of the text. queries use the FTS5 syntax, the static helpers build them
+// from plain user input
+class fulltext_index
+{
+public:
+    fulltext_index() = delete;
+    ~fulltext_index();
+
+    // the index is named <table>_fts unless a name is given
+    fulltext_index(database&                       database_,
+                   std::string const&              table,
+                   std::vector<std::string> const& columns,
+                   std::string const&              name      = "",
+                   std::string const&              tokenizer = "unicode61");
+
+    std::string const& name() const;
+
+    // creates the index and its triggers if missing, without indexing
+    // existing rows, see rebuild()
+    void create();
+    void drop();
+
+    // reindexes the whole table in one transaction (unless one is open),
+    // faster than triggers for bulk loads done before create()
+    void rebuild();
+    void optimize();
+
+    // bm25 column weights for the ranking, in column order
+    void weights(std::vector<double> const& weights_);
+
+    // rows of the table matching the query, best first, with their rank
+    // as the extra column "score" (lower is better); a limit of 0 returns
+    // every match
+    statement        search(std::string const& query,
+                            int const&         limit  = 0,
+                            int const&         offset = 0) const;
+    std::vector<row> search_rows(std::string const& query,
+                                 int const&         limit  = 0,
+                                 int const&         offset = 0) const;
+
+    std::size_t count(std::string const& query) const;
+
+    // quoted as one string, a phrase when it holds several words
+    static std::string term(std::string const& text);
+    // matches words starting with the text
+    static std::string prefix(std::string const& text);
+    static std::string all_of(std::vector<std::string> const& queries);
+    static std::string any_of(std::vector<std::string> const& queries);
+    static std::string near(std::vector<std::string> const& terms,
+                            int const&                      distance = 10);
+    static std::string in_column(std::string const& column_,
+                                 std::string const& query);
+
+
+private:
+    std::string search_sql(bool const& limited) const;
+
+    database&                m_database;
+    std::string              m_table;
+    std::vector<std::string> m_columns   = {};
+    std::string              m_name      = {};
+    std::string              m_tokenizer = {};
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,344 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <type_traits>
+#include <sqlite3.h>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace detail
+{
+template <typename T, typename = void>
+struct value_traits;
+
+
+template <typename T>
+struct value_traits<T, std::enable_if_t<std::is_integral_v<T>>>
+{
+    static T get(sqlite3_value* value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            return sqlite3_value_int(value) != 0;
+        else if constexpr (std::is_same_v<T, sqlite3_int64>)
+            return sqlite3_value_int64(value);
+        else
+            return static_cast<T>(sqlite3_value_int64(value));
+    }
+
+    static void result(sqlite3_context* context, T const& value)
+    {
+        if constexpr (std::is_same_v<T, sqlite3_int64>)
+            sqlite3_result_int64(context, value);
+        else
+            sqlite3_result_int64(context, static_cast<sqlite3_int64>(value));
+    }
+};
+
+
+template <typename T>
+struct value_traits<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+    static T get(sqlite3_value* value)
+    {
+        if constexpr (std::is_same_v<T, double>)
+            return sqlite3_value_double(value);
+        else
+            return static_cast<T>(sqlite3_value_double(value));
+    }
+
+    static void result(sqlite3_context* context, T const& value)
+    {
+        if constexpr (std::is_same_v<T, double>)
+            sqlite3_result_double(context, value);
+        else
+            sqlite3_result_double(context, static_cast<double>(value));
+    }
+};
+
+
+template <>
+struct value_traits<std::string_view>
+{
+    // only valid for the duration of the call
+    static std::string_view get(sqlite3_value* value)
+    {
+        auto const* text = sqlite3_value_text(value);
+        if (!text)
+            return {};
+        return {reinterpret_cast<char const*>(text),
+                static_cast<std::size_t>(sqlite3_value_bytes(value))};
+    }
+
+    static void result(sqlite3_context* context, std::string_view const& value)
+    {
+        sqlite3_result_text64(context,
+                              value.data(),
+                              value.size(),
+                              SQLITE_TRANSIENT,
+                              SQLITE_UTF8);
+    }
+};
+
+
+template <>
+struct value_traits<std::string>
+{
+    static std::string get(sqlite3_value* value)
+    {
+        return std::string {value_traits<std::string_view>::get(value)};
+    }
+
+    static void result(sqlite3_context* context, std::string const& value)
+    {
+        value_traits<std::string_view>::result(context, value);
+    }
+};
+
+
+template <>
+struct value_traits<std::vector<unsigned char>>
+{
+    static std::vector<unsigned char> get(sqlite3_value* value)
+    {
+        auto const* data = static_cast<unsigned char const*>(
+            sqlite3_value_blob(value));
+        if (!data)
+            return {};
+        return {data,
+                data + static_cast<std::size_t>(sqlite3_value_bytes(value))};
+    }
+
+    static void result(sqlite3_context*                  context,
+                       std::vector<unsigned char> const& value)
+    {
+        sqlite3_result_blob64(
+            context, value.data(), value.size(), SQLITE_TRANSIENT);
+    }
+};
+
+
+template <typename T>
+struct value_traits<std::optional<T>>
+{
+    static std::optional<T> get(sqlite3_value* value)
+    {
+        if (sqlite3_value_type(value) == SQLITE_NULL)
+            return std::nullopt;
+        return value_traits<T>::get(value);
+    }
+
+    static void result(sqlite3_context* context, std::optional<T> const& value)
+    {
+        if (value)
+            value_traits<T>::result(context, *value);
+        else
+            sqlite3_result_null(context);
+    }
+};
+
+
+template <typename T>
+struct callable_traits : callable_traits<decltype(&T::operator())>
+{
+};
+
+
+template <typename R, typename... A>
+struct callable_traits<R (*)(A...)>
+{
+    using result_type    = R;
+    using argument_types = std::tuple<std::decay_t<A>...>;
+};
+
+
+template <typename R, typename... A>
+struct callable_traits<R(A...)> : callable_traits<R (*)(A...)>
+{
+};
+
+
+template <typename C, typename R, typename... A>
+struct callable_traits<R (C::*)(A...)> : callable_traits<R (*)(A...)>
+{
+};
+
+
+template <typename C, typename R, typename... A>
+struct callable_traits<R (C::*)(A...) const> : callable_traits<R (*)(A...)>
+{
+};
+
+
+template <typename F>
+constexpr int argument_count()
+{
+    return static_cast<int>(
+        std::tuple_size_v<typename callable_traits<F>::argument_types>);
+}
+
+
+template <typename Arguments, typename F, std::size_t... I>
+decltype(auto) invoke_with(F&&          function,
+                           sqlite3_value** argv,
+                           std::index_sequence<I...>)
+{
+    return std::forward<F>(function)(
+        value_traits<std::tuple_element_t<I, Arguments>>::get(argv[I])...);
+}
+
+
+template <typename Traits, typename F>
+void call(sqlite3_context* context, F&& function, sqlite3_value** argv)
+{
+    using arguments = typename Traits::argument_types;
+    using result    = std::decay_t<typename Traits::result_type>;
+
+    auto const indices =
+        std::make_index_sequence<std::tuple_size_v<arguments>> {};
+
+    if constexpr (std::is_void_v<result>)
+    {
+        invoke_with<arguments>(std::forward<F>(function), argv, indices);
+        sqlite3_result_null(context);
+    }
+    else
+    {
+        value_traits<result>::result(
+            context,
+            invoke_with<arguments>(std::forward<F>(function), argv, indices));
+    }
+}
+
+
+template <typename F>
+void destroy(void* pointer)
+{
+    delete static_cast<F*>(pointer);
+}
+
+
+template <typename F>
+void scalar(sqlite3_context* context, int, sqlite3_value** argv)
+{
+    try
+    {
+        auto& function = *static_cast<F*>(sqlite3_user_data(context));
+        call<callable_traits<F>>(context, function, argv);
+    }
+    catch (std::bad_alloc const&)
+    {
+        sqlite3_result_error_nomem(context);
+    }
+    catch (std::exception const& e)
+    {
+        sqlite3_result_error(context, e.what(), -1);
+    }
+    catch (...)
+    {
+        sqlite3_result_error(context, "Unknown exception.", -1);
+    }
+}
+
+
+template <typename A>
+void aggregate_step(sqlite3_context* context, int, sqlite3_value** argv)
+{
+    try
+    {
+        auto** state = static_cast<A**>(
+            sqlite3_aggregate_context(context, sizeof(A*)));
+
+        if (!state)
+        {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+
+        if (!*state)
+            *state = new A {*static_cast<A const*>(sqlite3_user_data(context))};
+
+        using arguments =
+            typename callable_traits<decltype(&A::step)>::argument_types;
+
+        invoke_with<arguments>(
+            [state](auto&&... values)
+            { (*state)->step(std::forward<decltype(values)>(values)...); },
+            argv,
+            std::make_index_sequence<std::tuple_size_v<arguments>> {});
+    }
+    catch (std::bad_alloc const&)
+    {
+        sqlite3_result_error_nomem(context);
+    }
+    catch (std::exception const& e)
+    {
+        sqlite3_result_error(context, e.what(), -1);
+    }
+    catch (...)
+    {
+        sqlite3_result_error(context, "Unknown exception.", -1);
+    }
+}
+
+
+template <typename A>
+void aggregate_final(sqlite3_context* context)
+{
+    try
+    {
+        auto** state = static_cast<A**>(sqlite3_aggregate_context(context, 0));
+
+        // no rows were aggregated, finalize a fresh copy of the prototype
+        std::unique_ptr<A> aggregate {
+            state && *state
+                ? *state
+                : new A {*static_cast<A const*>(sqlite3_user_data(context))}};
+
+        using result = std::decay_t<decltype(aggregate->finalize())>;
+
+        value_traits<result>::result(context, aggregate->finalize());
+    }
+    catch (std::bad_alloc const&)
+    {
+        sqlite3_result_error_nomem(context);
+    }
+    catch (std::exception const& e)
+    {
+        sqlite3_result_error(context, e.what(), -1);
+    }
+    catch (...)
+    {
+        sqlite3_result_error(context, "Unknown exception.", -1);
+    }
+}
+} // namespace detail
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,130 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "invalidation_dispatcher.hh"
+#include <algorithm>
+
+namespace mm
+{
+namespace sqlite
+{
+invalidation_dispatcher::~invalidation_dispatcher()
+{
+    m_database.update_hook({});
+    m_database.commit_hook({});
+    m_database.committed_hook({});
+    m_database.rollback_hook({});
+}
+
+
+invalidation_dispatcher::invalidation_dispatcher(database& database_)
+    : m_database {database_}
+{
+    m_database.update_hook(
+        [this](change_type const&,
+               std::string_view const&,
+               std::string_view const& table,
+               sqlite3_int64 const&    rowid) { on_update(table, rowid); });
+
+    m_database.commit_hook(
+        [this]()
+        {
+            on_commit();
+            return true;
+        });
+
+    m_database.committed_hook([this]() { on_committed(); });
+    m_database.rollback_hook([this]() { on_rollback(); });
+}
+
+
+void invalidation_dispatcher::subscribe(std::string const& table,
+                                        callback const&    callback_)
+{
+    m_table_subscribers.emplace(table, callback_);
+}
+
+
+void invalidation_dispatcher::subscribe(callback const& callback_)
+{
+    m_subscribers.push_back(callback_);
+}
+
+
+std::size_t invalidation_dispatcher::pending() const
+{
+    std::size_t count = 0;
+    for (auto const& v : m_pending)
+        count += v.second.size();
+    for (auto const& v : m_committed)
+        count += v.second.size();
+    return count;
+}
+
+
+void invalidation_dispatcher::on_update(std::string_view const& table,
+                                        sqlite3_int64 const&    rowid)
+{
+    auto it = m_pending.find(table);
+    if (it == m_pending.end())
+        it = m_pending.emplace(table, std::vector<sqlite3_int64> {}).first;
+    it->second.push_back(rowid);
+}
+
+
+void invalidation_dispatcher::on_commit()
+{
+    // a commit failing with SQLITE_BUSY is retried, its changes merge
+    for (auto& v : m_pending)
+    {
+        auto& rowids = m_committed[v.first];
+        rowids.insert(rowids.end(), v.second.begin(), v.second.end());
+    }
+    m_pending.clear();
+}
+
+
+void invalidation_dispatcher::on_committed()
+{
+    changes_type changes {};
+    changes.swap(m_committed);
+
+    for (auto& v : changes)
+    {
+        auto& rowids = v.second;
+        std::sort(rowids.begin(), rowids.end());
+        rowids.erase(std::unique(rowids.begin(), rowids.end()), rowids.end());
+
+        auto const range = m_table_subscribers.equal_range(v.first);
+        for (auto it = range.first; it != range.second; ++it)
+            it->second(v.first, rowids);
+
+        for (auto const& subscriber : m_subscribers)
+            subscriber(v.first, rowids);
+    }
+}
+
+
+void invalidation_dispatcher::on_rollback()
+{
+    m_pending.clear();
+    m_committed.clear();
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,75 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <sqlite3.h>
+#include "database.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// batches rowid changes per table until commit, drops them on rollback;
+// subscribers run once the commit is durable, see database::committed_hook.
+// takes over the update, commit, committed and rollback hooks of the
+// database.
+// sqlite does not report WITHOUT ROWID tables, the truncate optimization and
+// REPLACE deletions through the update hook
+class invalidation_dispatcher
+{
+public:
+    using callback = std::function<void(std::string const&,
+                                        std::vector<sqlite3_int64> const&)>;
+
+    invalidation_dispatcher() = delete;
+    ~invalidation_dispatcher();
+
+    invalidation_dispatcher(database& database_);
+
+    invalidation_dispatcher(invalidation_dispatcher const&) = delete;
+    invalidation_dispatcher& operator=(invalidation_dispatcher const&) = delete;
+
+    void subscribe(std::string const& table, callback const& callback_);
+    void subscribe(callback const& callback_);
+
+    std::size_t pending() const;
+
+
+private:
+    using changes_type =
+        std::map<std::string, std::vector<sqlite3_int64>, std::less<>>;
+
+    void on_update(std::string_view const& table, sqlite3_int64 const& rowid);
+    void on_commit();
+    void on_committed();
+    void on_rollback();
+
+    database&    m_database;
+    changes_type m_pending   = {};
+    changes_type m_committed = {};
+    std::multimap<std::string, callback> m_table_subscribers = {};
+    std::vector<callback>                m_subscribers       = {};
+};
+} // namespace sqlite
+} // namespace mm
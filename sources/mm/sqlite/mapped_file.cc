@@ -0,0 +1,120 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "mapped_file.hh"
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace mm
+{
+namespace sqlite
+{
+mapped_file::~mapped_file()
+{
+    if (m_data)
+        munmap(m_data, m_size);
+}
+
+
+mapped_file::mapped_file(std::string const& path)
+{
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        throw std::runtime_error {"Failed to open file [" + path + "]."};
+
+    struct stat info = {};
+
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error {"Failed to stat file [" + path + "]."};
+    }
+
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    // empty files cannot be mapped
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error {"Failed to map file [" + path + "]."};
+        }
+
+        m_data = data;
+    }
+
+    ::close(fd);
+}
+
+
+char const* mapped_file::data() const
+{
+    return static_cast<char const*>(m_data);
+}
+
+
+std::size_t mapped_file::size() const { return m_size; }
+
+
+void mapped_file::advise(int const&         advice,
+                         std::size_t const& offset,
+                         std::size_t const& length) const
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+    // offsets must be page aligned
+    auto const page  = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto const begin = offset - offset % page;
+    auto const end =
+        length == 0 || offset + length > m_size ? m_size : offset + length;
+
+    madvise(static_cast<char*>(m_data) + begin, end - begin, advice);
+}
+
+
+std::size_t mapped_file::resident() const
+{
+    if (!m_data)
+        return 0;
+
+    auto const page  = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto const pages = (m_size + page - 1) / page;
+
+    std::vector<unsigned char> states(pages);
+
+    if (mincore(m_data, m_size, states.data()) != 0)
+        throw std::runtime_error {"Failed to get resident pages."};
+
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < pages; ++i)
+        if (states[i] & 1)
+            result += i + 1 < pages ? page : m_size - i * page;
+    return result;
+}
+} // namespace sqlite
+} // namespace mm
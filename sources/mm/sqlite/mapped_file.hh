@@ -0,0 +1,58 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace mm
+{
+namespace sqlite
+{
+// read-only memory mapping of a whole file
+class mapped_file
+{
+public:
+    mapped_file() = delete;
+    ~mapped_file();
+
+    mapped_file(std::string const& path);
+
+    mapped_file(mapped_file const&)            = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    char const* data() const;
+    std::size_t size() const;
+
+    // takes madvise(2) advice, e.g. MADV_SEQUENTIAL or MADV_WILLNEED
+    void advise(int const& advice,
+                std::size_t const& offset = 0,
+                std::size_t const& length = 0) const;
+
+    // bytes of the file currently in the page cache
+    std::size_t resident() const;
+
+
+private:
+    void*       m_data = nullptr;
+    std::size_t m_size = 0;
+};
+} // namespace sqlite
+} // namespace mm
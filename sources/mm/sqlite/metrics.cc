@@ -0,0 +1,295 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "metrics.hh"
+#include <limits>
+#include <locale>
+#include <sstream>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+constexpr auto relaxed = std::memory_order_relaxed;
+
+
+void counter(std::ostringstream& out,
+             std::string const&  name,
+             std::string const&  help,
+             std::uint64_t const& value)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " counter\n"
+        << name << " " << value << "\n";
+}
+
+
+void gauge(std::ostringstream& out,
+           std::string const&  name,
+           std::string const&  help,
+           std::int64_t const& value)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " gauge\n"
+        << name << " " << value << "\n";
+}
+
+
+void histogram(std::ostringstream&                out,
+               std::string const&                 name,
+               std::string const&                 help,
+               latency_histogram::snapshot const& value)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " histogram\n";
+
+    std::uint64_t cumulative = 0;
+
+    for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+    {
+        cumulative += value.buckets[i];
+
+        out << name << "_bucket{le=\"";
+        if (i + 1 < latency_histogram::bucket_count)
+            out << latency_histogram::snapshot::bound(i);
+        else
+            out << "+Inf";
+        out << "\"} " << cumulative << "\n";
+    }
+
+    out << name << "_sum " << value.seconds << "\n"
+        << name << "_count " << value.count << "\n";
+}
+} // namespace
+
+
+double latency_histogram::snapshot::bound(std::size_t const& bucket)
+{
+    if (bucket + 1 >= bucket_count)
+        return std::numeric_limits<double>::infinity();
+    return static_cast<double>(std::uint64_t {1} << bucket) * 1e-6;
+}
+
+
+latency_histogram::latency_histogram() = default;
+
+
+latency_histogram::~latency_histogram() = default;
+
+
+void latency_histogram::observe(std::chrono::nanoseconds const& duration)
+{
+    auto const nanos =
+        static_cast<std::uint64_t>(duration.count() > 0 ? duration.count() : 0);
+
+    // bucket i holds durations up to 2^i microseconds, bounds are inclusive
+    // like the le labels of prometheus
+    std::uint64_t const micros = (nanos + 999) / 1000;
+    std::size_t         bucket = 0;
+    if (micros > 1)
+        bucket = static_cast<std::size_t>(64 - __builtin_clzll(micros - 1));
+    if (bucket >= bucket_count)
+        bucket = bucket_count - 1;
+
+    m_buckets[bucket].fetch_add(1, relaxed);
+    m_count.fetch_add(1, relaxed);
+    m_nanos.fetch_add(nanos, relaxed);
+}
+
+
+latency_histogram::snapshot latency_histogram::take() const
+{
+    snapshot result {};
+    for (std::size_t i = 0; i < bucket_count; ++i)
+        result.buckets[i] = m_buckets[i].load(relaxed);
+    result.count   = m_count.load(relaxed);
+    result.seconds = static_cast<double>(m_nanos.load(relaxed)) * 1e-9;
+    return result;
+}
+
+
+metrics_registry::metrics_registry() = default;
+
+
+metrics_registry::~metrics_registry() = default;
+
+
+void metrics_registry::count_execute() { m_executes.fetch_add(1, relaxed); }
+
+
+void metrics_registry::count_row(std::uint64_t const& bytes)
+{
+    m_rows.fetch_add(1, relaxed);
+    m_bytes_fetched.fetch_add(bytes, relaxed);
+}
+
+
+void metrics_registry::count_bound(std::uint64_t const& bytes)
+{
+    m_bytes_bound.fetch_add(bytes, relaxed);
+}
+
+
+void metrics_registry::count_error(int const& code)
+{
+    m_errors[static_cast<std::size_t>(code & 0xff)].fetch_add(1, relaxed);
+}
+
+
+void metrics_registry::observe_prepare(std::chrono::nanoseconds const& duration)
+{
+    m_prepare.observe(duration);
+}
+
+
+void metrics_registry::observe_step(std::chrono::nanoseconds const& duration)
+{
+    m_step.observe(duration);
+}
+
+
+void metrics_registry::observe_commit(std::chrono::nanoseconds const& duration)
+{
+    m_commit.observe(duration);
+}
+
+
+metrics_registry::snapshot metrics_registry::take() const
+{
+    snapshot result {};
+    result.executes      = m_executes.load(relaxed);
+    result.rows          = m_rows.load(relaxed);
+    result.bytes_bound   = m_bytes_bound.load(relaxed);
+    result.bytes_fetched = m_bytes_fetched.load(relaxed);
+
+    for (std::size_t i = 0; i < m_errors.size(); ++i)
+        if (auto const count = m_errors[i].load(relaxed))
+            result.errors.emplace(static_cast<int>(i), count);
+
+    result.prepare = m_prepare.take();
+    result.step    = m_step.take();
+    result.commit  = m_commit.take();
+    return result;
+}
+
+
+std::string metrics_registry::prometheus(snapshot const&    snapshot_,
+                                         std::string const& prefix)
+{
+    // independent of the global locale, prometheus expects plain numbers
+    std::ostringstream out {};
+    out.imbue(std::locale::classic());
+    out.precision(10);
+
+    auto const& s = snapshot_;
+    auto const& c = snapshot_.connection;
+
+    counter(out,
+            prefix + "_executes_total",
+            "Statement runs started.",
+            s.executes);
+    counter(out, prefix + "_rows_total", "Rows fetched.", s.rows);
+    counter(out,
+            prefix + "_bound_bytes_total",
+            "Bytes bound to statement parameters.",
+            s.bytes_bound);
+    counter(out,
+            prefix + "_fetched_bytes_total",
+            "Bytes of fetched rows.",
+            s.bytes_fetched);
+    counter(out,
+            prefix + "_busy_retries_total",
+            "Busy handler retries.",
+            s.busy_retries);
+    counter(out,
+            prefix + "_result_cache_hits_total",
+            "Result cache hits.",
+            s.cache_hits);
+    counter(out,
+            prefix + "_result_cache_misses_total",
+            "Result cache misses.",
+            s.cache_misses);
+
+    out << "# HELP " << prefix << "_errors_total Errors by result code.\n"
+        << "# TYPE " << prefix << "_errors_total counter\n";
+    for (auto const& v : s.errors)
+        out << prefix << "_errors_total{code=\"" << v.first << "\"} "
+            << v.second << "\n";
+
+    histogram(out,
+              prefix + "_prepare_seconds",
+              "Statement prepare latency.",
+              s.prepare);
+    histogram(out, prefix + "_step_seconds", "Statement step latency.", s.step);
+    histogram(out,
+              prefix + "_commit_seconds",
+              "Explicit COMMIT latency.",
+              s.commit);
+
+    gauge(out,
+          prefix + "_page_cache_used_bytes",
+          "Page cache memory.",
+          c.cache_used);
+    counter(out,
+            prefix + "_page_cache_hits_total",
+            "Page cache hits.",
+            static_cast<std::uint64_t>(c.cache_hit));
+    counter(out,
+            prefix + "_page_cache_misses_total",
+            "Page cache misses.",
+            static_cast<std::uint64_t>(c.cache_miss));
+    counter(out,
+            prefix + "_page_cache_writes_total",
+            "Pages written.",
+            static_cast<std::uint64_t>(c.cache_write));
+    counter(out,
+            prefix + "_page_cache_spills_total",
+            "Dirty pages spilled mid-transaction.",
+            static_cast<std::uint64_t>(c.cache_spill));
+    gauge(out,
+          prefix + "_lookaside_used_slots",
+          "Lookaside slots in use.",
+          c.lookaside_used);
+    counter(out,
+            prefix + "_lookaside_hits_total",
+            "Lookaside allocations.",
+            static_cast<std::uint64_t>(c.lookaside_hit));
+    counter(out,
+            prefix + "_lookaside_miss_size_total",
+            "Allocations too large for lookaside.",
+            static_cast<std::uint64_t>(c.lookaside_miss_size));
+    counter(out,
+            prefix + "_lookaside_miss_full_total",
+            "Allocations missed with lookaside full.",
+            static_cast<std::uint64_t>(c.lookaside_miss_full));
+    gauge(out,
+          prefix + "_schema_used_bytes",
+          "Schema memory.",
+          c.schema_used);
+    gauge(out,
+          prefix + "_statement_used_bytes",
+          "Prepared statement memory.",
+          c.statement_used);
+
+    return out.str();
+}
+} // namespace sqlite
+} // namespace mm
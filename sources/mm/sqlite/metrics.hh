@@ -0,0 +1,139 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+namespace mm
+{
+namespace sqlite
+{
+// counts durations into power of two buckets from 1 microsecond up to
+// about 8 seconds, the last bucket takes everything longer
+class latency_histogram
+{
+public:
+    static constexpr std::size_t bucket_count = 25;
+
+    struct snapshot
+    {
+        std::array<std::uint64_t, bucket_count> buckets = {};
+        std::uint64_t                           count   = 0;
+        double                                  seconds = 0.0;
+
+        // upper bound of a bucket in seconds, infinite for the last one
+        static double bound(std::size_t const& bucket);
+    };
+
+    latency_histogram();
+    ~latency_histogram();
+
+    latency_histogram(latency_histogram const&)            = delete;
+    latency_histogram& operator=(latency_histogram const&) = delete;
+
+    void     observe(std::chrono::nanoseconds const& duration);
+    snapshot take() const;
+
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> m_buckets = {};
+    std::atomic<std::uint64_t>                           m_count   = {0};
+    std::atomic<std::uint64_t>                           m_nanos   = {0};
+};
+
+
+// statement counters of one connection; updates are relaxed atomics so
+// that reading a snapshot never blocks the connection
+class metrics_registry
+{
+public:
+    // sampled from sqlite3_db_status, current values except for the
+    // cache and lookaside hit/miss/spill/write counters
+    struct connection_status
+    {
+        std::int64_t cache_used          = 0;
+        std::int64_t cache_hit           = 0;
+        std::int64_t cache_miss          = 0;
+        std::int64_t cache_write         = 0;
+        std::int64_t cache_spill         = 0;
+        std::int64_t lookaside_used      = 0;
+        std::int64_t lookaside_hit       = 0;
+        std::int64_t lookaside_miss_size = 0;
+        std::int64_t lookaside_miss_full = 0;
+        std::int64_t schema_used         = 0;
+        std::int64_t statement_used      = 0;
+    };
+
+    struct snapshot
+    {
+        std::uint64_t                executes      = 0;
+        std::uint64_t                rows          = 0;
+        std::uint64_t                bytes_bound   = 0;
+        std::uint64_t                bytes_fetched = 0;
+        std::uint64_t                busy_retries  = 0;
+        std::uint64_t                cache_hits    = 0;
+        std::uint64_t                cache_misses  = 0;
+        std::map<int, std::uint64_t> errors        = {};
+        latency_histogram::snapshot  prepare       = {};
+        latency_histogram::snapshot  step          = {};
+        latency_histogram::snapshot  commit        = {};
+        connection_status            connection    = {};
+    };
+
+    metrics_registry();
+    ~metrics_registry();
+
+    metrics_registry(metrics_registry const&)            = delete;
+    metrics_registry& operator=(metrics_registry const&) = delete;
+
+    void count_execute();
+    void count_row(std::uint64_t const& bytes);
+    void count_bound(std::uint64_t const& bytes);
+    void count_error(int const& code);
+
+    void observe_prepare(std::chrono::nanoseconds const& duration);
+    void observe_step(std::chrono::nanoseconds const& duration);
+    void observe_commit(std::chrono::nanoseconds const& duration);
+
+    // counters and histograms only, errors are keyed by primary result code
+    snapshot take() const;
+
+    // prometheus text exposition format
+    static std::string prometheus(snapshot const&    snapshot_,
+                                  std::string const& prefix = "mmsqlite");
+
+
+private:
+    std::atomic<std::uint64_t>                  m_executes      = {0};
+    std::atomic<std::uint64_t>                  m_rows          = {0};
+    std::atomic<std::uint64_t>                  m_bytes_bound   = {0};
+    std::atomic<std::uint64_t>                  m_bytes_fetched = {0};
+    std::array<std::atomic<std::uint64_t>, 256> m_errors        = {};
+    latency_histogram                           m_prepare;
+    latency_histogram                           m_step;
+    latency_histogram                           m_commit;
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,63 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "query_plan.hh"
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+scan_watchdog::~scan_watchdog() = default;
+
+
+scan_watchdog::scan_watchdog(callback const& callback_,
+                             int const&      fullscan_steps,
+                             int const&      autoindex)
+    : m_callback {callback_}
+    , m_fullscan_steps {fullscan_steps}
+    , m_autoindex {autoindex}
+{
+    if (!m_callback)
+        throw std::runtime_error {"Invalid scan watchdog callback."};
+    if (m_fullscan_steps < 0 || m_autoindex < 0)
+        throw std::runtime_error {"Invalid scan watchdog threshold."};
+}
+
+
+int const& scan_watchdog::fullscan_steps() const { return m_fullscan_steps; }
+
+
+int const& scan_watchdog::autoindex() const { return m_autoindex; }
+
+
+bool scan_watchdog::exceeded(scan_report const& report) const
+{
+    return (m_fullscan_steps > 0 &&
+            report.fullscan_steps >= m_fullscan_steps) ||
+           (m_autoindex > 0 && report.autoindex >= m_autoindex);
+}
+
+
+void scan_watchdog::notify(scan_report const& report) const
+{
+    m_callback(report);
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,78 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace mm
+{
+namespace sqlite
+{
+// one line of EXPLAIN QUERY PLAN, e.g. "SCAN t" or "SEARCH t USING INDEX i"
+struct plan_node
+{
+    int                    id       = 0;
+    int                    parent   = 0;
+    std::string            detail   = {};
+    std::vector<plan_node> children = {};
+};
+
+
+struct scan_report
+{
+    std::string sql            = {};
+    int         fullscan_steps = 0;
+    int         autoindex      = 0;
+    int         sorts          = 0;
+    int         vm_steps       = 0;
+};
+
+
+// reports statements that step through full table scans or build automatic
+// indexes at least as often as the thresholds, a threshold of 0 disables
+// the check; the report carries the normalized sql when sqlite supports it
+class scan_watchdog
+{
+public:
+    using callback = std::function<void(scan_report const&)>;
+
+    scan_watchdog() = delete;
+    ~scan_watchdog();
+
+    scan_watchdog(callback const& callback_,
+                  int const&      fullscan_steps = 1000,
+                  int const&      autoindex      = 1);
+
+    int const& fullscan_steps() const;
+    int const& autoindex() const;
+
+    bool exceeded(scan_report const& report) const;
+    void notify(scan_report const& report) const;
+
+
+private:
+    callback m_callback       = {};
+    int      m_fullscan_steps = 0;
+    int      m_autoindex      = 0;
+};
+} // namespace sqlite
+} // namespace mm
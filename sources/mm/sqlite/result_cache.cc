@@ -0,0 +1,222 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "result_cache.hh"
+#include <iterator>
+
+namespace mm
+{
+namespace sqlite
+{
+namespace
+{
+std::size_t estimate(std::string const&      key_,
+                     std::vector<row> const& rows,
+                     std::set<std::string> const& tables)
+{
+    // rough heap footprint, node overheads are approximated
+    std::size_t bytes = sizeof(std::list<int>) + key_.size() + 64;
+
+    for (auto const& table : tables)
+        bytes += table.size() + 64;
+
+    for (auto const& r : rows)
+    {
+        bytes += sizeof(row);
+        for (auto const& v : r.columns())
+            bytes += 64 + sizeof(column) + v.first.size() +
+                     v.second.value().size() + v.second.parameter().size();
+    }
+
+    return bytes;
+}
+} // namespace
+
+
+double result_cache::statistics::hit_rate() const
+{
+    auto const total = hits + misses;
+    return total ? static_cast<double>(hits) / static_cast<double>(total)
+                 : 0.0;
+}
+
+
+result_cache::~result_cache() = default;
+
+
+result_cache::result_cache(std::size_t const& budget) : m_budget {budget} {}
+
+
+std::string result_cache::key(std::string const& sql_, row const& row_)
+{
+    // the sql text is used as is, sqlite's normalized sql replaces literals
+    // with '?' and would alias queries differing only in literals
+
+    std::string result = sql_;
+
+    for (auto const& v : row_.columns())
+    {
+        result += '\x1e';
+        result += v.first;
+        result += '\x1f';
+        result += std::to_string(static_cast<int>(v.second.type()));
+        result += '\x1f';
+        result += v.second.parameter();
+        result += '\x1f';
+        result += v.second.value();
+    }
+
+    return result;
+}
+
+
+std::optional<std::vector<row>> result_cache::find(std::string const& key_)
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+
+    auto const it = m_index.find(key_);
+
+    if (it == m_index.end())
+        return std::nullopt;
+
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->rows;
+}
+
+
+void result_cache::insert(std::string const&           key_,
+                          std::vector<row> const&      rows,
+                          std::set<std::string> const& tables)
+{
+    std::size_t const bytes = estimate(key_, rows, tables);
+
+    std::lock_guard<std::mutex> lock {m_mutex};
+
+    // lookups of statements that turn out to be writes are not misses,
+    // only results that could have been served are counted
+    ++m_stats.misses;
+
+    if (bytes > m_budget)
+        return;
+
+    auto const found = m_index.find(key_);
+    if (found != m_index.end())
+        erase(found->second);
+
+    m_entries.push_front(entry {key_, rows, tables, bytes});
+
+    auto const it = m_entries.begin();
+    m_index.emplace(it->key, it);
+    for (auto const& table : it->tables)
+        m_tables[table].insert(it->key);
+
+    m_stats.bytes += bytes;
+    ++m_stats.insertions;
+
+    evict();
+}
+
+
+void result_cache::invalidate(std::string_view const& table)
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+
+    auto const found = m_tables.find(std::string {table});
+
+    if (found == m_tables.end())
+        return;
+
+    auto const keys = found->second;
+
+    for (auto const& key_ : keys)
+    {
+        auto const it = m_index.find(key_);
+        if (it == m_index.end())
+            continue;
+        erase(it->second);
+        ++m_stats.invalidations;
+    }
+}
+
+
+void result_cache::clear()
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+    m_index.clear();
+    m_tables.clear();
+    m_entries.clear();
+    m_stats.bytes = 0;
+}
+
+
+void result_cache::budget(std::size_t const& budget_)
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+    m_budget = budget_;
+    evict();
+}
+
+
+std::size_t result_cache::budget() const
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+    return m_budget;
+}
+
+
+result_cache::statistics result_cache::stats() const
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+    statistics result = m_stats;
+    result.entries    = m_entries.size();
+    result.budget     = m_budget;
+    return result;
+}
+
+
+// the iterator is taken by value, callers pass the one stored in m_index
+void result_cache::erase(entries_type::iterator it)
+{
+    for (auto const& table : it->tables)
+    {
+        auto const found = m_tables.find(table);
+        if (found == m_tables.end())
+            continue;
+        found->second.erase(it->key);
+        if (found->second.empty())
+            m_tables.erase(found);
+    }
+
+    m_index.erase(it->key);
+    m_stats.bytes -= it->bytes;
+    m_entries.erase(it);
+}
+
+
+void result_cache::evict()
+{
+    while (m_stats.bytes > m_budget && !m_entries.empty())
+    {
+        erase(std::prev(m_entries.end()));
+        ++m_stats.evictions;
+    }
+}
+} // namespace sqlite
+} // namespace mm
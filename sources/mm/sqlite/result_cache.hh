@@ -0,0 +1,101 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+#include <unordered_map>
+#include "row.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+class result_cache
+{
+public:
+    struct statistics
+    {
+        std::uint64_t hits          = 0;
+        std::uint64_t misses        = 0;
+        std::uint64_t insertions    = 0;
+        std::uint64_t evictions     = 0;
+        std::uint64_t invalidations = 0;
+        std::size_t   entries       = 0;
+        std::size_t   bytes         = 0;
+        std::size_t   budget        = 0;
+
+        double hit_rate() const;
+    };
+
+    result_cache() = delete;
+    ~result_cache();
+
+    result_cache(std::size_t const& budget);
+
+    static std::string key(std::string const& sql_, row const& row_);
+
+    std::optional<std::vector<row>> find(std::string const& key_);
+
+    void insert(std::string const&           key_,
+                std::vector<row> const&      rows,
+                std::set<std::string> const& tables);
+
+    void invalidate(std::string_view const& table);
+    void clear();
+
+    void        budget(std::size_t const& budget_);
+    std::size_t budget() const;
+
+    statistics stats() const;
+
+
+private:
+    struct entry
+    {
+        std::string           key    = {};
+        std::vector<row>      rows   = {};
+        std::set<std::string> tables = {};
+        std::size_t           bytes  = 0;
+    };
+
+    using entries_type = std::list<entry>;
+
+    void erase(entries_type::iterator it);
+    void evict();
+
+    mutable std::mutex m_mutex;
+
+    entries_type m_entries = {};
+    std::unordered_map<std::string_view, entries_type::iterator> m_index = {};
+    std::unordered_map<std::string, std::set<std::string_view>>  m_tables =
+        {};
+
+    std::size_t m_budget = 0;
+    statistics  m_stats  = {};
+};
+} // namespace sqlite
+} // namespace mm
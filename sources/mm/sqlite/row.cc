@@ -52,7 +52,7 @@ void row::append(std::string const& name, column const& value)
 std::map<std::string, column> const& row::columns() const { return m_columns; }
 
 
-void row::bind(std::shared_ptr<sqlite3_stmt> const& sqlite_statement) const
+void row::bind(sqlite3_stmt* sqlite_statement) const
 {
     for (auto const& v : m_columns)
         v.second.bind(sqlite_statement);
@@ -21,7 +21,6 @@
 
 #include <string>
 #include <map>
-#include <memory>
 #include <sqlite3.h>
 #include "enums.hh"
 #include "column.hh"
@@ -43,7 +42,7 @@ public:
 
     std::map<std::string, column> const& columns() const;
 
-    void bind(std::shared_ptr<sqlite3_stmt> const& sqlite_statement) const;
+    void bind(sqlite3_stmt* sqlite_statement) const;
 
 
 private:
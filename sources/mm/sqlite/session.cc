@@ -0,0 +1,311 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "session.hh"
+#include <limits>
+#include <set>
+#include <memory>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+#if defined(SQLITE_ENABLE_SESSION) && defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+
+namespace
+{
+session::bytes to_bytes(int const& result, int const& size, void* data)
+{
+    std::unique_ptr<void, decltype(&sqlite3_free)> guard {data, &sqlite3_free};
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to get sqlite changeset."};
+
+    auto const* begin = static_cast<unsigned char const*>(data);
+
+    if (!begin)
+        return {};
+
+    return {begin, begin + static_cast<std::size_t>(size)};
+}
+
+
+int size_of(session::bytes const& changeset_)
+{
+    if (changeset_.size() >
+        static_cast<std::size_t>(std::numeric_limits<int>::max()))
+        throw std::runtime_error {"Sqlite changeset too large."};
+    return static_cast<int>(changeset_.size());
+}
+
+
+void* data_of(session::bytes const& changeset_)
+{
+    // sqlite does not modify input changesets
+    return const_cast<unsigned char*>(changeset_.data());
+}
+
+
+std::set<std::string> tables_of(session::bytes const& changeset_)
+{
+    sqlite3_changeset_iter* iterator = nullptr;
+
+    if (sqlite3changeset_start(
+            &iterator, size_of(changeset_), data_of(changeset_)) != SQLITE_OK)
+        throw std::runtime_error {"Failed to read sqlite changeset."};
+
+    std::unique_ptr<sqlite3_changeset_iter,
+                    decltype(&sqlite3changeset_finalize)>
+        guard {iterator, &sqlite3changeset_finalize};
+
+    std::set<std::string> tables {};
+
+    while (sqlite3changeset_next(iterator) == SQLITE_ROW)
+    {
+        char const* table     = nullptr;
+        int         columns   = 0;
+        int         operation = 0;
+        int         indirect_ = 0;
+
+        if (sqlite3changeset_op(
+                iterator, &table, &columns, &operation, &indirect_) ==
+                SQLITE_OK &&
+            table)
+            tables.insert(table);
+    }
+
+    return tables;
+}
+
+
+int on_conflict(void* context, int conflict, sqlite3_changeset_iter* iterator)
+{
+    auto const* handler =
+        static_cast<session::conflict_handler const*>(context);
+
+    if (!*handler)
+        return SQLITE_CHANGESET_ABORT;
+
+    char const* table     = nullptr;
+    int         columns   = 0;
+    int         operation = 0;
+    int         indirect_ = 0;
+
+    if (sqlite3changeset_op(
+            iterator, &table, &columns, &operation, &indirect_) != SQLITE_OK)
+        return SQLITE_CHANGESET_ABORT;
+
+    try
+    {
+        auto const action = (*handler)(static_cast<conflict_type>(conflict),
+                                       table ? table : "",
+                                       static_cast<change_type>(operation));
+
+        // replacing is only valid for data and conflict conflicts
+        if (action == conflict_action::REPLACE &&
+            conflict != SQLITE_CHANGESET_DATA &&
+            conflict != SQLITE_CHANGESET_CONFLICT)
+            return SQLITE_CHANGESET_ABORT;
+
+        return static_cast<int>(action);
+    }
+    catch (...)
+    {
+        return SQLITE_CHANGESET_ABORT;
+    }
+}
+} // namespace
+
+
+session::~session()
+{
+    if (m_session)
+        sqlite3session_delete(m_session);
+}
+
+
+session::session(database const& database_, std::string const& schema)
+{
+    if (!database_.opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    if (sqlite3session_create(database_.handle(), schema.c_str(), &m_session) !=
+        SQLITE_OK)
+        throw std::runtime_error {"Failed to create sqlite session."};
+}
+
+
+void session::attach(std::string const& table)
+{
+    if (sqlite3session_attach(m_session, table.c_str()) != SQLITE_OK)
+        throw std::runtime_error {"Failed to attach table to sqlite session."};
+}
+
+
+void session::attach_all()
+{
+    if (sqlite3session_attach(m_session, nullptr) != SQLITE_OK)
+        throw std::runtime_error {"Failed to attach tables to sqlite session."};
+}
+
+
+void session::enable(bool const& enable_)
+{
+    sqlite3session_enable(m_session, enable_ ? 1 : 0);
+}
+
+
+bool session::enabled() const
+{
+    return sqlite3session_enable(m_session, -1) != 0;
+}
+
+
+void session::indirect(bool const& indirect_)
+{
+    sqlite3session_indirect(m_session, indirect_ ? 1 : 0);
+}
+
+
+bool session::empty() const { return sqlite3session_isempty(m_session) != 0; }
+
+
+session::bytes session::changeset() const
+{
+    int   size = 0;
+    void* data = nullptr;
+    int const result = sqlite3session_changeset(m_session, &size, &data);
+    return to_bytes(result, size, data);
+}
+
+
+session::bytes session::patchset() const
+{
+    int   size = 0;
+    void* data = nullptr;
+    int const result = sqlite3session_patchset(m_session, &size, &data);
+    return to_bytes(result, size, data);
+}
+
+
+session::bytes session::invert(bytes const& changeset_)
+{
+    int   size = 0;
+    void* data = nullptr;
+    int const result = sqlite3changeset_invert(
+        size_of(changeset_), data_of(changeset_), &size, &data);
+    return to_bytes(result, size, data);
+}
+
+
+session::bytes session::concat(bytes const& first, bytes const& second)
+{
+    int   size = 0;
+    void* data = nullptr;
+    int const result = sqlite3changeset_concat(size_of(first),
+                                               data_of(first),
+                                               size_of(second),
+                                               data_of(second),
+                                               &size,
+                                               &data);
+    return to_bytes(result, size, data);
+}
+
+
+void session::apply(database const&         database_,
+                    bytes const&            changeset_,
+                    conflict_handler const& handler)
+{
+    if (!database_.opened())
+        throw std::runtime_error {"Database is not opened."};
+
+    int const result =
+        sqlite3changeset_apply(database_.handle(),
+                               size_of(changeset_),
+                               data_of(changeset_),
+                               nullptr,
+                               &on_conflict,
+                               const_cast<conflict_handler*>(&handler));
+
+    if (result == SQLITE_ABORT)
+        throw std::runtime_error {"Aborted applying sqlite changeset."};
+
+    if (result != SQLITE_OK)
+        throw std::runtime_error {"Failed to apply sqlite changeset."};
+
+    // the changes went through handle(), not through a statement
+    database_.written(tables_of(changeset_));
+}
+
+#else
+
+session::~session() = default;
+
+
+session::session(database const&, std::string const&)
+{
+    throw std::runtime_error {"SQLite session extension is not enabled."};
+}
+
+
+void session::attach(std::string const&) {}
+
+
+void session::attach_all() {}
+
+
+void session::enable(bool const&) {}
+
+
+bool session::enabled() const { return false; }
+
+
+void session::indirect(bool const&) {}
+
+
+bool session::empty() const { return true; }
+
+
+session::bytes session::changeset() const { return {}; }
+
+
+session::bytes session::patchset() const { return {}; }
+
+
+session::bytes session::invert(bytes const&)
+{
+    throw std::runtime_error {"SQLite session extension is not enabled."};
+}
+
+
+session::bytes session::concat(bytes const&, bytes const&)
+{
+    throw std::runtime_error {"SQLite session extension is not enabled."};
+}
+
+
+void session::apply(database const&, bytes const&, conflict_handler const&)
+{
+    throw std::runtime_error {"SQLite session extension is not enabled."};
+}
+
+#endif
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,79 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <sqlite3.h>
+#include "enums.hh"
+#include "database.hh"
+
+struct sqlite3_session;
+
+namespace mm
+{
+namespace sqlite
+{
+// records changes made through a database into changesets or patchsets,
+// requires SQLITE_ENABLE_SESSION and SQLITE_ENABLE_PREUPDATE_HOOK;
+// the database must stay open for the lifetime of the session
+class session
+{
+public:
+    using bytes            = std::vector<unsigned char>;
+    using conflict_handler = std::function<conflict_action(
+        conflict_type const&, std::string const&, change_type const&)>;
+
+    session() = delete;
+    ~session();
+
+    session(database const& database_, std::string const& schema = "main");
+
+    session(session const&)            = delete;
+    session& operator=(session const&) = delete;
+
+    void attach(std::string const& table);
+    void attach_all();
+
+    void enable(bool const& enable_);
+    bool enabled() const;
+
+    void indirect(bool const& indirect_);
+    bool empty() const;
+
+    bytes changeset() const;
+    bytes patchset() const;
+
+    static bytes invert(bytes const& changeset_);
+    static bytes concat(bytes const& first, bytes const& second);
+
+    // conflicts abort the application unless a handler decides otherwise,
+    // an aborted application is rolled back and throws
+    static void apply(database const&         database_,
+                      bytes const&            changeset_,
+                      conflict_handler const& handler = {});
+
+
+private:
+    sqlite3_session* m_session = nullptr;
+};
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,170 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sharded_database.hh"
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+sharded_database::~sharded_database()
+{
+    // drain the threads before their databases close
+    for (auto& v : m_shards)
+        v->thread.stop();
+}
+
+
+sharded_database::sharded_database(std::vector<std::string> const& paths,
+                                   int const&                      flags,
+                                   router const&                   router_)
+    : m_router {router_}
+{
+    if (paths.empty())
+        throw std::runtime_error {"No shards given."};
+
+    if (!m_router)
+        throw std::runtime_error {"Invalid shard router."};
+
+    for (auto const& path : paths)
+    {
+        m_shards.push_back(std::make_unique<shard_type>());
+        m_shards.back()->db.open(path, flags);
+    }
+}
+
+
+std::size_t sharded_database::size() const { return m_shards.size(); }
+
+
+std::size_t sharded_database::shard(std::string const& key) const
+{
+    std::size_t const index = m_router(key, m_shards.size());
+    if (index >= m_shards.size())
+        throw std::runtime_error {"Shard router returned an invalid shard."};
+    return index;
+}
+
+
+std::vector<row> sharded_database::execute(std::string const& key,
+                                           std::string const& sql_)
+{
+    return execute(key, sql_, {});
+}
+
+
+std::vector<row> sharded_database::execute(std::string const& key,
+                                           std::string const& sql_,
+                                           row const&         row_)
+{
+    return submit(key, sql_, row_).get();
+}
+
+
+std::future<std::vector<row>> sharded_database::submit(std::string const& key,
+                                                       std::string const& sql_,
+                                                       row const&         row_)
+{
+    return run(shard(key),
+               [sql_, row_](database& db) { return db.execute(sql_, row_); });
+}
+
+
+std::vector<row> sharded_database::execute_all(std::string const& sql_)
+{
+    return execute_all(sql_, {});
+}
+
+
+std::vector<row> sharded_database::execute_all(std::string const& sql_,
+                                               row const&         row_)
+{
+    std::vector<std::future<std::vector<row>>> futures {};
+    futures.reserve(m_shards.size());
+
+    for (std::size_t i = 0; i < m_shards.size(); ++i)
+        futures.push_back(run(i,
+                              [&sql_, &row_](database& db)
+                              { return db.execute(sql_, row_); }));
+
+    // every future is waited on before rethrowing, tasks reference sql_ and
+    // row_
+    std::vector<row>   results {};
+    std::exception_ptr error {};
+
+    for (auto& future : futures)
+    {
+        try
+        {
+            auto rows = future.get();
+            results.insert(results.end(),
+                           std::make_move_iterator(rows.begin()),
+                           std::make_move_iterator(rows.end()));
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return results;
+}
+
+
+std::size_t sharded_database::hash_router(std::string const& key,
+                                          std::size_t const& shards)
+{
+    // 64-bit FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (char const chr : key)
+    {
+        hash ^= static_cast<unsigned char>(chr);
+        hash *= 1099511628211ull;
+    }
+
+    return hash % shards;
+}
+
+
+sharded_database::router
+sharded_database::range_router(std::vector<std::string> const& bounds)
+{
+    if (!std::is_sorted(bounds.begin(), bounds.end()))
+        throw std::runtime_error {"Shard bounds are not sorted."};
+
+    return [bounds](std::string const& key, std::size_t const& shards)
+    {
+        auto const it = std::upper_bound(bounds.begin(), bounds.end(), key);
+        auto const index =
+            static_cast<std::size_t>(std::distance(bounds.begin(), it));
+        return index < shards ? index : shards - 1;
+    };
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,108 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <future>
+#include <functional>
+#include <type_traits>
+#include "row.hh"
+#include "worker.hh"
+#include "database.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// one database and one thread per shard, every operation on a shard runs on
+// its thread so that shards write in parallel
+class sharded_database
+{
+public:
+    using router = std::function<std::size_t(std::string const&,
+                                             std::size_t const&)>;
+
+    sharded_database() = delete;
+    ~sharded_database();
+
+    sharded_database(std::vector<std::string> const& paths,
+                     int const&                      flags,
+                     router const&                   router_ = hash_router);
+
+    sharded_database(sharded_database const&)            = delete;
+    sharded_database& operator=(sharded_database const&) = delete;
+
+    std::size_t size() const;
+    std::size_t shard(std::string const& key) const;
+
+    std::vector<row> execute(std::string const& key, std::string const& sql_);
+    std::vector<row> execute(std::string const& key,
+                             std::string const& sql_,
+                             row const&         row_);
+
+    std::future<std::vector<row>> submit(std::string const& key,
+                                         std::string const& sql_,
+                                         row const&         row_ = {});
+
+    // scatter-gather, results are concatenated in shard order
+    std::vector<row> execute_all(std::string const& sql_);
+    std::vector<row> execute_all(std::string const& sql_, row const& row_);
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function, database&>>
+    run(std::size_t const& shard_, Function&& function);
+
+    // stable across platforms, unlike std::hash
+    static std::size_t hash_router(std::string const& key,
+                                   std::size_t const& shards);
+
+    // keys below bounds[i] go to shard i, the rest to the last shard
+    static router range_router(std::vector<std::string> const& bounds);
+
+
+private:
+    struct shard_type
+    {
+        database db;
+        worker   thread;
+    };
+
+    std::vector<std::unique_ptr<shard_type>> m_shards = {};
+    router                                   m_router = {};
+};
+
+
+template <typename Function>
+std::future<std::invoke_result_t<Function, database&>>
+sharded_database::run(std::size_t const& shard_, Function&& function)
+{
+    if (shard_ >= m_shards.size())
+        throw std::runtime_error {"Invalid shard."};
+
+    database& db = m_shards[shard_]->db;
+
+    return m_shards[shard_]->thread.run(
+        [&db, function = std::forward<Function>(function)]() mutable
+        { return function(db); });
+}
+} // namespace sqlite
+} // namespace mm
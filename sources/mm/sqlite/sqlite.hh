@@ -21,8 +21,27 @@
 
 #include "version.hh"
 #include "enums.hh"
+#include "errors.hh"
 #include "utilities.hh"
+#include "configuration.hh"
 #include "column.hh"
 #include "row.hh"
+#include "cancellation.hh"
+#include "busy_policy.hh"
+#include "function.hh"
+#include "container_table.hh"
+#include "query_plan.hh"
+#include "metrics.hh"
 #include "statement.hh"
+#include "result_cache.hh"
 #include "database.hh"
+#include "invalidation_dispatcher.hh"
+#include "session.hh"
+#include "worker.hh"
+#include "sharded_database.hh"
+#include "async_database.hh"
+#include "mapped_file.hh"
+#include "warmup.hh"
+#include "bulk_loader.hh"
+#include "batch_inserter.hh"
+#include "fulltext_index.hh"
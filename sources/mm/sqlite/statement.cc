@@ -18,13 +18,63 @@
 
 
 #include "statement.hh"
+#include "errors.hh"
 #include <stdexcept>
+#include <cctype>
+#include <cstdint>
 #include <iostream>
 
 namespace mm
 {
 namespace sqlite
 {
+namespace
+{
+struct plan_line
+{
+    int         id     = 0;
+    int         parent = 0;
+    std::string detail = {};
+};
+
+
+std::vector<plan_node> plan_children(std::vector<plan_line> const& lines,
+                                     int const&                    parent)
+{
+    std::vector<plan_node> nodes = {};
+    for (auto const& line : lines)
+    {
+        if (line.parent != parent)
+            continue;
+        nodes.push_back(
+            {line.id, line.parent, line.detail, plan_children(lines, line.id)});
+    }
+    return nodes;
+}
+
+
+bool commits(std::string const& sql_)
+{
+    std::size_t i = 0;
+    while (i < sql_.size() && std::isspace(static_cast<unsigned char>(sql_[i])))
+        ++i;
+
+    std::string keyword {};
+    while (i < sql_.size() && std::isalpha(static_cast<unsigned char>(sql_[i])))
+        keyword += static_cast<char>(
+            std::toupper(static_cast<unsigned char>(sql_[i++])));
+
+    return keyword == "COMMIT" || keyword == "END";
+}
+} // namespace
+
+
+void statement::finalizer::operator()(sqlite3_stmt* stmt) const
+{
+    sqlite3_finalize(stmt);
+}
+
+
 statement::~statement() { finalize(); }
 
 
@@ -34,6 +84,15 @@ statement::statement(std::shared_ptr<sqlite3> const& sqlite_database)
 }
 
 
+statement::statement(statement&& other) noexcept = default;
+
+
+statement& statement::operator=(statement&& other) noexcept = default;
+
+
+sqlite3_stmt* statement::handle() const { return m_statement.get(); }
+
+
 std::string statement::sql() const
 {
     return m_statement ? sqlite3_sql(m_statement.get()) : "";
@@ -58,12 +117,14 @@ std::string statement::normalized_sql() const
 
 void statement::log_error() const
 {
-    if (!m_database)
+    auto const database_ = m_database.lock();
+
+    if (!database_)
         return;
 
-    int const errcode          = sqlite3_errcode(m_database.get());
-    int const extended_errcode = sqlite3_extended_errcode(m_database.get());
-    std::string const errmsg   = sqlite3_errmsg(m_database.get());
+    int const errcode          = sqlite3_errcode(database_.get());
+    int const extended_errcode = sqlite3_extended_errcode(database_.get());
+    std::string const errmsg   = sqlite3_errmsg(database_.get());
 
     std::cerr << "| SQLite Error ::"
               << " Code [" << errcode << "]"
@@ -74,30 +135,59 @@ void statement::log_error() const
 
 void statement::prepare(std::string const& sql_)
 {
-    if (!m_database)
+    // once prepared, the statement reaches its connection through
+    // sqlite3_db_handle, sqlite3_close_v2 keeps it until finalization
+    auto const database_ = m_database.lock();
+
+    if (!database_)
         throw std::runtime_error {"Invalid sqlite database."};
 
-    sqlite3_stmt* stmt = nullptr;
+    sqlite3* const db   = database_.get();
+    sqlite3_stmt*  stmt = nullptr;
+
+    finalize();
+
+    m_deterministic  = true;
+    m_changes_schema = false;
+    m_read_tables.clear();
+    m_written_tables.clear();
+    m_functions.clear();
+
+    if (m_track_dependencies)
+        sqlite3_set_authorizer(db, &statement::authorize, this);
+
+    auto const metrics_ = m_metrics.lock();
+    auto const started  = metrics_ ? std::chrono::steady_clock::now()
+                                   : std::chrono::steady_clock::time_point {};
 
     int const result =
-        sqlite3_prepare_v2(m_database.get(), sql_.c_str(), -1, &stmt, nullptr);
+        sqlite3_prepare_v2(db, sql_.c_str(), -1, &stmt, nullptr);
 
-    static auto _finalize = [](sqlite3_stmt* ptr)
+    if (metrics_)
     {
-        sqlite3_finalize(ptr);
-        ptr = nullptr;
-    };
+        metrics_->observe_prepare(std::chrono::steady_clock::now() - started);
+        if (result != SQLITE_OK)
+            metrics_->count_error(result);
+    }
+
+    if (m_track_dependencies)
+        sqlite3_set_authorizer(db, nullptr, nullptr);
 
     if (result != SQLITE_OK)
     {
         if (m_logging)
             std::cerr << "| Error SQL :: " << sql_ << std::endl;
         log_error();
-        _finalize(stmt);
+        sqlite3_finalize(stmt);
+        if ((result & 0xff) == SQLITE_BUSY)
+            throw busy_error {"Database is busy, failed to prepare sqlite "
+                              "statement."};
         throw std::runtime_error {"Failed to prepare sqlite statement."};
     }
 
-    m_statement.reset(stmt, _finalize);
+    m_statement.reset(stmt);
+    m_readonly = sqlite3_stmt_readonly(stmt) != 0;
+    m_commit   = commits(sql_);
 }
 
 
@@ -105,7 +195,17 @@ void statement::bind(row const& row_) const
 {
     if (!m_statement)
         throw std::runtime_error {"Statement is not initialized"};
-    row_.bind(m_statement);
+    row_.bind(m_statement.get());
+
+    auto const metrics_ = m_metrics.lock();
+    if (!metrics_)
+        return;
+
+    std::uint64_t bytes = 0;
+    for (auto const& v : row_.columns())
+        if (!v.second.parameter().empty())
+            bytes += v.second.value().size();
+    metrics_->count_bound(bytes);
 }
 
 
@@ -128,8 +228,49 @@ void statement::step()
         m_step_logged = true;
     }
 
+    if (m_database.expired())
+        throw std::runtime_error {"Database of the statement is closed."};
+
+    sqlite3* const db       = sqlite3_db_handle(m_statement.get());
+    bool const     limited_ = limited();
+
+    if (limited_)
+    {
+        check_limits();
+        sqlite3_progress_handler(
+            db, m_progress_interval, &statement::progress, this);
+    }
+
+    std::chrono::steady_clock::time_point started {};
+
+    auto const metrics_ = m_metrics.lock();
+    if (metrics_)
+    {
+        if (!sqlite3_stmt_busy(m_statement.get()))
+            metrics_->count_execute();
+        started = std::chrono::steady_clock::now();
+    }
+
     int const result = sqlite3_step(m_statement.get());
 
+    if (metrics_)
+    {
+        auto const elapsed = std::chrono::steady_clock::now() - started;
+        metrics_->observe_step(elapsed);
+        if (m_commit && result == SQLITE_DONE)
+            metrics_->observe_commit(elapsed);
+        if (result != SQLITE_ROW && result != SQLITE_DONE)
+            metrics_->count_error(result);
+    }
+
+    if (limited_)
+        sqlite3_progress_handler(db, 0, nullptr, nullptr);
+
+    if (result != SQLITE_ROW)
+        inspect();
+
+    invalidate();
+
     switch (result)
     {
     case SQLITE_ROW:
@@ -144,12 +285,27 @@ void statement::step()
         m_step_logged = false;
         break;
     }
+    case SQLITE_INTERRUPT:
+    {
+        log_error();
+        check_limits();
+        throw interrupt_error {"Interrupted sqlite statement."};
+    }
+    case SQLITE_BUSY:
+    {
+        log_error();
+        throw busy_error {"Database is busy, failed to step into sqlite "
+                          "statement."};
+    }
     default:
     {
         log_error();
         throw std::runtime_error {"Failed to step into sqlite statement."};
     }
     }
+
+    if (!m_has_row && m_completion)
+        m_completion();
 }
 
 
@@ -224,6 +380,14 @@ row statement::get_row() const
         }
     }
 
+    if (auto const metrics_ = m_metrics.lock())
+    {
+        std::uint64_t bytes = 0;
+        for (auto const& v : result.columns())
+            bytes += v.second.value().size();
+        metrics_->count_row(bytes);
+    }
+
     return result;
 }
 
@@ -255,5 +419,328 @@ void statement::logging(bool const& enable) { m_logging = enable; }
 
 
 bool statement::logging() const { return m_logging; }
+
+
+void statement::timeout(std::chrono::milliseconds const& timeout_)
+{
+    deadline(std::chrono::steady_clock::now() + timeout_);
+}
+
+
+void statement::deadline(std::chrono::steady_clock::time_point const& deadline_)
+{
+    m_deadline = deadline_;
+}
+
+
+std::chrono::steady_clock::time_point const& statement::deadline() const
+{
+    return m_deadline;
+}
+
+
+void statement::cancellation(std::optional<cancellation_token> const& token)
+{
+    m_cancellation = token;
+}
+
+
+std::optional<cancellation_token> const& statement::cancellation() const
+{
+    return m_cancellation;
+}
+
+
+void statement::progress_interval(int const& instructions)
+{
+    if (instructions <= 0)
+        throw std::runtime_error {"Invalid progress interval."};
+    m_progress_interval = instructions;
+}
+
+
+int const& statement::progress_interval() const { return m_progress_interval; }
+
+
+void statement::track_dependencies(bool const& enable)
+{
+    m_track_dependencies = enable;
+}
+
+
+bool const& statement::track_dependencies() const
+{
+    return m_track_dependencies;
+}
+
+
+bool statement::readonly() const { return m_readonly; }
+
+
+bool statement::deterministic() const { return m_deterministic; }
+
+
+std::set<std::string> const& statement::read_tables() const
+{
+    return m_read_tables;
+}
+
+
+std::set<std::string> const& statement::written_tables() const
+{
+    return m_written_tables;
+}
+
+
+std::set<std::string> const& statement::functions() const
+{
+    return m_functions;
+}
+
+
+int statement::status(statement_status const& counter,
+                      bool const&             reset_counter) const
+{
+    if (!m_statement)
+        throw std::runtime_error {"Statement is not initialized."};
+    return sqlite3_stmt_status(m_statement.get(),
+                               static_cast<int>(counter),
+                               reset_counter ? 1 : 0);
+}
+
+
+std::vector<plan_node> statement::query_plan() const
+{
+    if (!m_statement)
+        throw std::runtime_error {"Statement is not initialized."};
+
+    statement explain {m_database.lock()};
+    explain.logging(m_logging);
+
+    std::vector<plan_line> lines = {};
+
+    // columns are id, parent, notused and detail
+    for (auto const& r : explain.execute("EXPLAIN QUERY PLAN " + sql()))
+    {
+        auto const& columns = r.columns();
+        lines.push_back({std::stoi(columns.at("id").value()),
+                         std::stoi(columns.at("parent").value()),
+                         columns.at("detail").value()});
+    }
+
+    return plan_children(lines, 0);
+}
+
+
+void statement::watchdog(std::optional<scan_watchdog> const& watchdog_)
+{
+    m_watchdog = watchdog_;
+}
+
+
+std::optional<scan_watchdog> const& statement::watchdog() const
+{
+    return m_watchdog;
+}
+
+
+void statement::metrics(std::shared_ptr<metrics_registry> const& registry)
+{
+    m_metrics = registry;
+}
+
+
+std::shared_ptr<metrics_registry> statement::metrics() const
+{
+    return m_metrics.lock();
+}
+
+
+void statement::cache(std::shared_ptr<result_cache> const& cache_)
+{
+    m_cache = cache_;
+}
+
+
+std::shared_ptr<result_cache> statement::cache() const
+{
+    return m_cache.lock();
+}
+
+
+void statement::completion(std::function<void()> const& callback)
+{
+    m_completion = callback;
+}
+
+
+int statement::progress(void* context)
+{
+    auto const* stmt = static_cast<statement const*>(context);
+    return (stmt->m_cancellation && stmt->m_cancellation->cancelled()) ||
+                   stmt->expired()
+               ? 1
+               : 0;
+}
+
+
+int statement::authorize(void*       context,
+                         int         action,
+                         char const* argument1,
+                         char const* argument2,
+                         char const*,
+                         char const*)
+{
+    auto* stmt = static_cast<statement*>(context);
+
+    switch (action)
+    {
+    case SQLITE_READ:
+    {
+        if (argument1)
+            stmt->m_read_tables.insert(argument1);
+        break;
+    }
+    case SQLITE_INSERT:
+    case SQLITE_UPDATE:
+    case SQLITE_DELETE:
+    {
+        if (argument1)
+            stmt->m_written_tables.insert(argument1);
+        break;
+    }
+    // schema and attachment changes may shadow or remove any table, they
+    // are neither cached nor tracked per table
+    case SQLITE_CREATE_INDEX:
+    case SQLITE_CREATE_TABLE:
+    case SQLITE_CREATE_TEMP_INDEX:
+    case SQLITE_CREATE_TEMP_TABLE:
+    case SQLITE_CREATE_TEMP_TRIGGER:
+    case SQLITE_CREATE_TEMP_VIEW:
+    case SQLITE_CREATE_TRIGGER:
+    case SQLITE_CREATE_VIEW:
+    case SQLITE_CREATE_VTABLE:
+    case SQLITE_DROP_INDEX:
+    case SQLITE_DROP_TABLE:
+    case SQLITE_DROP_TEMP_INDEX:
+    case SQLITE_DROP_TEMP_TABLE:
+    case SQLITE_DROP_TEMP_TRIGGER:
+    case SQLITE_DROP_TEMP_VIEW:
+    case SQLITE_DROP_TRIGGER:
+    case SQLITE_DROP_VIEW:
+    case SQLITE_DROP_VTABLE:
+    case SQLITE_ALTER_TABLE:
+    case SQLITE_ATTACH:
+    case SQLITE_DETACH:
+    {
+        stmt->m_deterministic  = false;
+        stmt->m_changes_schema = true;
+        break;
+    }
+    case SQLITE_PRAGMA:
+    {
+        stmt->m_deterministic = false;
+        break;
+    }
+    case SQLITE_FUNCTION:
+    {
+        static std::set<std::string> const volatile_functions = {
+            "random",
+            "randomblob",
+            "changes",
+            "total_changes",
+            "last_insert_rowid",
+            "date",
+            "time",
+            "datetime",
+            "julianday",
+            "unixepoch",
+            "strftime",
+            "current_date",
+            "current_time",
+            "current_timestamp",
+            "sqlite_offset",
+        };
+        if (!argument2)
+            break;
+        stmt->m_functions.insert(argument2);
+        if (volatile_functions.count(argument2))
+            stmt->m_deterministic = false;
+        break;
+    }
+    default:
+    {
+        break;
+    }
+    }
+
+    return SQLITE_OK;
+}
+
+
+bool statement::limited() const
+{
+    return m_cancellation ||
+           m_deadline != std::chrono::steady_clock::time_point::max();
+}
+
+
+bool statement::expired() const
+{
+    return m_deadline != std::chrono::steady_clock::time_point::max() &&
+           std::chrono::steady_clock::now() >= m_deadline;
+}
+
+
+void statement::check_limits() const
+{
+    if (m_cancellation && m_cancellation->cancelled())
+        throw interrupt_error {"Cancelled sqlite statement."};
+    if (expired())
+        throw timeout_error {"Deadline exceeded for sqlite statement."};
+}
+
+
+void statement::inspect()
+{
+    if (!m_watchdog)
+        return;
+
+    // counters restart so that a reset statement is judged per run
+    scan_report report {};
+    report.fullscan_steps = status(statement_status::FULLSCAN_STEP, true);
+    report.autoindex      = status(statement_status::AUTOINDEX, true);
+    report.sorts          = status(statement_status::SORT, true);
+    report.vm_steps       = status(statement_status::VM_STEP, true);
+
+    if (!m_watchdog->exceeded(report))
+        return;
+
+    report.sql = normalized_sql();
+    if (report.sql.empty())
+        report.sql = sql();
+
+    m_watchdog->notify(report);
+}
+
+
+void statement::invalidate() const
+{
+    // ATTACH and DETACH count as read-only
+    if (m_readonly && !m_changes_schema)
+        return;
+
+    auto const cache_ = m_cache.lock();
+    if (!cache_)
+        return;
+
+    // the update hook misses WITHOUT ROWID tables and the truncate
+    // optimization, so the written tables come from the authorizer
+    if (!m_track_dependencies || m_changes_schema)
+        cache_->clear();
+    else
+        for (auto const& table : m_written_tables)
+            cache_->invalidate(table);
+}
 } // namespace sqlite
 } // namespace mm
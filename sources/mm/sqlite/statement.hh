@@ -22,8 +22,17 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <set>
+#include <chrono>
+#include <optional>
+#include <functional>
 #include <sqlite3.h>
 #include "row.hh"
+#include "enums.hh"
+#include "cancellation.hh"
+#include "query_plan.hh"
+#include "metrics.hh"
+#include "result_cache.hh"
 
 namespace mm
 {
@@ -35,8 +44,18 @@ public:
     statement() = delete;
     ~statement();
 
+    // the connection is only observed, statements of a closed database
+    // throw instead of touching it
     statement(std::shared_ptr<sqlite3> const& sqlite_database);
 
+    statement(statement&& other) noexcept;
+    statement& operator=(statement&& other) noexcept;
+
+    statement(statement const&)            = delete;
+    statement& operator=(statement const&) = delete;
+
+    sqlite3_stmt* handle() const;
+
     std::string sql() const;
     std::string expanded_sql() const;
     std::string normalized_sql() const;
@@ -59,13 +78,92 @@ public:
     void logging(bool const& enable);
     bool logging() const;
 
+    void timeout(std::chrono::milliseconds const& timeout_);
+    void deadline(std::chrono::steady_clock::time_point const& deadline_);
+    std::chrono::steady_clock::time_point const& deadline() const;
+
+    void cancellation(std::optional<cancellation_token> const& token);
+    std::optional<cancellation_token> const& cancellation() const;
+
+    void progress_interval(int const& instructions);
+    int const& progress_interval() const;
+
+    void        track_dependencies(bool const& enable);
+    bool const& track_dependencies() const;
+
+    bool                         readonly() const;
+    bool                         deterministic() const;
+    std::set<std::string> const& read_tables() const;
+    std::set<std::string> const& written_tables() const;
+    std::set<std::string> const& functions() const;
+
+    int status(statement_status const& counter,
+               bool const&             reset_counter = false) const;
+
+    // plan of the prepared statement, as a forest of top level steps
+    std::vector<plan_node> query_plan() const;
+
+    // inspects the scan counters whenever a run of the statement ends
+    void watchdog(std::optional<scan_watchdog> const& watchdog_);
+    std::optional<scan_watchdog> const& watchdog() const;
+
+    // the registry is observed, disabling metrics stops the recording
+    void metrics(std::shared_ptr<metrics_registry> const& registry);
+    std::shared_ptr<metrics_registry> metrics() const;
+
+    // steps of a writing statement invalidate the tables it writes, or the
+    // whole cache when dependencies are not tracked; the cache is observed
+    void cache(std::shared_ptr<result_cache> const& cache_);
+    std::shared_ptr<result_cache> cache() const;
+
+    // runs after each step that ends a run of the statement
+    void completion(std::function<void()> const& callback);
+
 
 private:
-    std::shared_ptr<sqlite3_stmt>   m_statement;
-    std::shared_ptr<sqlite3> const& m_database;
-    bool                            m_has_row     = false;
-    bool                            m_logging     = false;
-    bool                            m_step_logged = false;
+    struct finalizer
+    {
+        void operator()(sqlite3_stmt* stmt) const;
+    };
+
+    static int progress(void* context);
+    static int authorize(void*       context,
+                         int         action,
+                         char const* argument1,
+                         char const* argument2,
+                         char const* database_name,
+                         char const* trigger);
+
+    bool limited() const;
+    bool expired() const;
+    void check_limits() const;
+    void inspect();
+    void invalidate() const;
+
+    std::unique_ptr<sqlite3_stmt, finalizer> m_statement   = {};
+    std::weak_ptr<sqlite3>                   m_database    = {};
+    bool                                     m_has_row     = false;
+    bool                                     m_logging     = false;
+    bool                                     m_step_logged = false;
+
+    std::chrono::steady_clock::time_point m_deadline =
+        std::chrono::steady_clock::time_point::max();
+    std::optional<cancellation_token> m_cancellation      = {};
+    int                               m_progress_interval = 1000;
+
+    bool                  m_track_dependencies = false;
+    bool                  m_readonly           = false;
+    bool                  m_deterministic      = true;
+    bool                  m_changes_schema     = false;
+    std::set<std::string> m_read_tables        = {};
+    std::set<std::string> m_written_tables     = {};
+    std::set<std::string> m_functions          = {};
+
+    std::optional<scan_watchdog>    m_watchdog   = {};
+    std::weak_ptr<metrics_registry> m_metrics    = {};
+    bool                            m_commit     = false;
+    std::weak_ptr<result_cache>     m_cache      = {};
+    std::function<void()>           m_completion = {};
 };
 } // namespace sqlite
 } // namespace mm
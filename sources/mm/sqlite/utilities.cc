@@ -62,6 +62,19 @@ void valid_sqlite_identifier(std::string const& identifier)
 }
 
 
+std::string quote_identifier(std::string const& identifier)
+{
+    std::string result = "\"";
+    for (char const v : identifier)
+    {
+        if (v == '"')
+            result += '"';
+        result += v;
+    }
+    return result + "\"";
+}
+
+
 std::string to_string(int const& value) { return std::to_string(value); }
 
 
@@ -27,6 +27,9 @@ namespace sqlite
 {
 void valid_sqlite_identifier(std::string const& identifier);
 
+// double quoted, with embedded quotes doubled
+std::string quote_identifier(std::string const& identifier);
+
 
 std::string to_string(int const& value);
 
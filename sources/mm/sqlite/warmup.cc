@@ -0,0 +1,158 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "warmup.hh"
+#include "errors.hh"
+#include "database.hh"
+#include "utilities.hh"
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace mm
+{
+namespace sqlite
+{
+double warmup::progress::resident_fraction() const
+{
+    return file_bytes ? static_cast<double>(resident_bytes) /
+                            static_cast<double>(file_bytes)
+                      : 1.0;
+}
+
+
+warmup::~warmup() { stop(); }
+
+
+warmup::warmup(std::string const&              path,
+               warmup_mode const&              mode,
+               std::vector<std::string> const& objects)
+    : m_file {path}
+    , m_mode {mode}
+    , m_objects {objects}
+{
+    switch (m_mode)
+    {
+    case warmup_mode::NONE:
+    {
+        m_finished = true;
+        break;
+    }
+    case warmup_mode::WILLNEED:
+    {
+        // the kernel reads ahead asynchronously, status() shows how far
+        m_file.advise(MADV_WILLNEED);
+        m_finished = true;
+        break;
+    }
+    case warmup_mode::SEQUENTIAL:
+    {
+        m_thread = std::thread {&warmup::scan, this, path};
+        break;
+    }
+    default:
+    {
+        throw std::runtime_error {"Invalid warmup mode."};
+    }
+    }
+}
+
+
+warmup::progress warmup::status() const
+{
+    progress result {};
+    result.objects        = m_objects_total.load(std::memory_order_relaxed);
+    result.objects_warmed = m_objects_warmed.load(std::memory_order_relaxed);
+    result.file_bytes     = m_file.size();
+    result.resident_bytes = m_file.resident();
+    result.finished       = m_finished.load(std::memory_order_acquire);
+    return result;
+}
+
+
+void warmup::wait()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+
+void warmup::stop()
+{
+    m_cancellation.cancel();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+
+void warmup::scan(std::string const& path)
+{
+    try
+    {
+        database db {path, SQLITE_OPEN_READONLY};
+        db.cancellation(m_cancellation);
+        db.execute("PRAGMA mmap_size = " + std::to_string(m_file.size()));
+
+        auto const schema = db.execute(
+            "SELECT type, name, tbl_name FROM sqlite_master "
+            "WHERE type IN ('table', 'index') AND rootpage > 0 "
+            "ORDER BY tbl_name, type DESC, name");
+
+        std::vector<std::string> queries {};
+
+        for (auto const& v : schema)
+        {
+            auto const& type  = v.columns().at("type").value();
+            auto const& name  = v.columns().at("name").value();
+            auto const& table = v.columns().at("tbl_name").value();
+
+            if (!m_objects.empty() &&
+                std::find(m_objects.begin(), m_objects.end(), name) ==
+                    m_objects.end())
+                continue;
+
+            // counting rows visits every page of the chosen b-tree
+            queries.push_back(
+                "SELECT count(*) AS c FROM " + quote_identifier(table) +
+                (type == "index" ? " INDEXED BY " + quote_identifier(name)
+                                 : std::string {" NOT INDEXED"}));
+        }
+
+        m_objects_total = queries.size();
+
+        for (auto const& v : queries)
+        {
+            db.execute(v);
+            m_objects_warmed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch (interrupt_error const&)
+    {
+    }
+    catch (...)
+    {
+        m_error = std::current_exception();
+    }
+
+    m_finished.store(true, std::memory_order_release);
+}
+} // namespace sqlite
+} // namespace mm
@@ -0,0 +1,84 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include "enums.hh"
+#include "mapped_file.hh"
+#include "cancellation.hh"
+
+namespace mm
+{
+namespace sqlite
+{
+// brings a database file into the page cache, either by asking the kernel
+// to read all of it ahead (WILLNEED) or by walking the b-trees of the given
+// tables and indexes, all of them by default, on a background read-only
+// connection (SEQUENTIAL)
+class warmup
+{
+public:
+    struct progress
+    {
+        std::size_t objects        = 0;
+        std::size_t objects_warmed = 0;
+        std::size_t file_bytes     = 0;
+        std::size_t resident_bytes = 0;
+        bool        finished       = false;
+
+        double resident_fraction() const;
+    };
+
+    warmup() = delete;
+    ~warmup();
+
+    warmup(std::string const&              path,
+           warmup_mode const&              mode,
+           std::vector<std::string> const& objects = {});
+
+    warmup(warmup const&)            = delete;
+    warmup& operator=(warmup const&) = delete;
+
+    progress status() const;
+
+    // waits for the scan to end and rethrows its failure
+    void wait();
+    void stop();
+
+
+private:
+    void scan(std::string const& path);
+
+    mapped_file              m_file;
+    warmup_mode              m_mode           = warmup_mode::NONE;
+    std::vector<std::string> m_objects        = {};
+    std::atomic<std::size_t> m_objects_total  = {0};
+    std::atomic<std::size_t> m_objects_warmed = {0};
+    std::atomic<bool>        m_finished       = {false};
+    cancellation_token       m_cancellation   = {};
+    std::exception_ptr       m_error          = {};
+    std::thread              m_thread;
+};
+} // namespace sqlite
+} // namespace mm
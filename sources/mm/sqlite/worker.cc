@@ -0,0 +1,96 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "worker.hh"
+#include <stdexcept>
+
+namespace mm
+{
+namespace sqlite
+{
+worker::worker() : m_thread {&worker::loop, this} {}
+
+
+worker::~worker() { stop(); }
+
+
+void worker::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        if (m_stopping)
+            throw std::runtime_error {"Worker is stopped."};
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+
+std::size_t worker::pending() const
+{
+    std::lock_guard<std::mutex> lock {m_mutex};
+    return m_tasks.size();
+}
+
+
+void worker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock {m_mutex};
+        m_stopping = true;
+    }
+    m_condition.notify_one();
+
+    // queued tasks still run before the thread exits
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+
+void worker::loop()
+{
+    while (true)
+    {
+        std::function<void()> task {};
+
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+            m_condition.wait(
+                lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        // the thread outlives a failing task, run() hands results and
+        // exceptions back through a future
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+        }
+    }
+}
+} // namespace sqlite
+} // namespace mm
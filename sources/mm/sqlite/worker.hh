@@ -0,0 +1,80 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace mm
+{
+namespace sqlite
+{
+// a single thread running submitted tasks in order
+class worker
+{
+public:
+    worker();
+    ~worker();
+
+    worker(worker const&)            = delete;
+    worker& operator=(worker const&) = delete;
+
+    // exceptions of submitted tasks are dropped
+    void submit(std::function<void()> task);
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> run(Function&& function);
+
+    std::size_t pending() const;
+
+    void stop();
+
+
+private:
+    void loop();
+
+    mutable std::mutex                m_mutex;
+    std::condition_variable           m_condition;
+    std::deque<std::function<void()>> m_tasks    = {};
+    bool                              m_stopping = false;
+    std::thread                       m_thread;
+};
+
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> worker::run(Function&& function)
+{
+    using result_type = std::invoke_result_t<Function>;
+
+    auto task = std::make_shared<std::packaged_task<result_type()>>(
+        std::forward<Function>(function));
+
+    auto future = task->get_future();
+    submit([task]() { (*task)(); });
+    return future;
+}
+} // namespace sqlite
+} // namespace mm
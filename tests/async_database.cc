@@ -0,0 +1,267 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <mutex>
+#include <deque>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <coroutine>
+#include <exception>
+#include <condition_variable>
+
+
+namespace
+{
+int const flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+
+// coroutine started eagerly and destroyed when it returns
+struct detached
+{
+    struct promise_type
+    {
+        detached            get_return_object() { return {}; }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() {}
+        void                unhandled_exception() { std::terminate(); }
+    };
+};
+
+
+// resumes coroutines on the thread calling run()
+class loop
+{
+public:
+    void post(std::coroutine_handle<> const& handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_handles.push_back(handle);
+        }
+        m_condition.notify_one();
+    }
+
+    void run(bool const& done)
+    {
+        while (!done)
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+            m_condition.wait(lock, [this]() { return !m_handles.empty(); });
+            auto handle = m_handles.front();
+            m_handles.pop_front();
+            lock.unlock();
+            handle.resume();
+        }
+    }
+
+
+private:
+    std::mutex                          m_mutex     = {};
+    std::condition_variable             m_condition = {};
+    std::deque<std::coroutine_handle<>> m_handles   = {};
+};
+
+
+detached queries(mm::sqlite::async_database& db, bool& done)
+{
+    co_await db.run(
+        [](mm::sqlite::database& conn)
+        {
+            conn.execute("CREATE TABLE t (a INTEGER)");
+            conn.execute("BEGIN");
+            for (int i = 1; i <= 1000; ++i)
+                conn.execute("INSERT INTO t VALUES (:a)",
+                             mm::sqlite::row {"a",
+                                              mm::sqlite::column {i, "a"}});
+            conn.execute("COMMIT");
+        });
+
+    // any connection of the pool sees the committed rows
+    for (std::size_t i = 0; i < 2 * db.size(); ++i)
+    {
+        auto rows = co_await db.execute("SELECT count(*) AS c FROM t");
+        MM_CHECK(rows.at(0).columns().at("c").value() == "1000");
+    }
+
+    auto const sum = co_await db.run(
+        [](mm::sqlite::database& conn)
+        {
+            return conn.execute("SELECT sum(a) AS s FROM t")
+                .at(0)
+                .columns()
+                .at("s")
+                .value();
+        });
+    MM_CHECK(sum == "500500");
+
+    done = true;
+}
+
+
+detached streams(mm::sqlite::async_database& db, bool& done)
+{
+    {
+        auto rows = db.stream("SELECT a FROM t ORDER BY a", {}, 64);
+
+        int expected = 0;
+        while (auto v = co_await rows.next())
+            MM_CHECK(v->columns().at("a").value() ==
+                     std::to_string(++expected));
+        MM_CHECK(expected == 1000);
+        MM_CHECK(!co_await rows.next());
+    }
+
+    {
+        // abandoned streams release their statement on its connection
+        auto rows = db.stream("SELECT a FROM t ORDER BY a", {}, 16);
+        auto v    = co_await rows.next();
+        MM_CHECK(v && v->columns().at("a").value() == "1");
+    }
+
+    done = true;
+}
+
+
+detached errors(mm::sqlite::async_database& db, bool& done)
+{
+    bool thrown = false;
+    try
+    {
+        co_await db.execute("SELECT a FROM missing");
+    }
+    catch (std::runtime_error const&)
+    {
+        thrown = true;
+    }
+    MM_CHECK(thrown);
+
+    thrown = false;
+    try
+    {
+        co_await db.run([](mm::sqlite::database&) { throw 5; });
+    }
+    catch (int const& v)
+    {
+        thrown = v == 5;
+    }
+    MM_CHECK(thrown);
+
+    // a failing stream reports its error once, then ends
+    {
+        auto rows = db.stream("SELECT a FROM missing");
+
+        thrown = false;
+        try
+        {
+            co_await rows.next();
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+        MM_CHECK(thrown);
+        MM_CHECK(!co_await rows.next());
+    }
+
+    // the connection stays usable after errors
+    auto rows = co_await db.execute("SELECT count(*) AS c FROM t");
+    MM_CHECK(rows.at(0).columns().at("c").value() == "1000");
+
+    done = true;
+}
+
+
+// without an executor coroutines resume on the connection threads
+detached without_executor(mm::sqlite::async_database& db,
+                          std::promise<std::thread::id>& resumed)
+{
+    co_await db.execute("SELECT 1 AS v");
+    resumed.set_value(std::this_thread::get_id());
+}
+} // namespace
+
+
+int main()
+{
+    std::remove("async_database.db");
+
+    {
+        loop events {};
+
+        mm::sqlite::async_database db {
+            "async_database.db",
+            flags,
+            3,
+            [&events](std::coroutine_handle<> handle) { events.post(handle); }};
+        MM_CHECK(db.size() == 3);
+
+        bool done = false;
+        queries(db, done);
+        events.run(done);
+
+        done = false;
+        streams(db, done);
+        events.run(done);
+
+        done = false;
+        errors(db, done);
+        events.run(done);
+
+        MM_CHECK(db.pending() == 0);
+    }
+
+    {
+        mm::sqlite::async_database db {"async_database.db", flags, 1};
+
+        std::promise<std::thread::id> resumed {};
+        without_executor(db, resumed);
+        MM_CHECK(resumed.get_future().get() != std::this_thread::get_id());
+    }
+
+    bool thrown = false;
+    try
+    {
+        mm::sqlite::async_database db {"async_database.db", flags, 0};
+    }
+    catch (std::runtime_error const&)
+    {
+        thrown = true;
+    }
+    MM_CHECK(thrown);
+
+    std::remove("async_database.db");
+
+    return EXIT_SUCCESS;
+}
+
+#else
+
+int main() { return MM_SKIP; }
+
+#endif
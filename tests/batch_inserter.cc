@@ -0,0 +1,196 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+
+namespace
+{
+void create(mm::sqlite::database& db)
+{
+    db.open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.execute("CREATE TABLE t (k INTEGER PRIMARY KEY, a TEXT NOT NULL, b)");
+}
+
+
+using columns = std::map<std::string, mm::sqlite::column>;
+
+
+std::vector<mm::sqlite::row> rows(int const&         first,
+                                  int const&         count,
+                                  std::string const& prefix = "a")
+{
+    std::vector<mm::sqlite::row> result {};
+    for (int i = first; i < first + count; ++i)
+        result.push_back(mm::sqlite::row {columns {
+            {"k", mm::sqlite::column {i, "k"}},
+            {"a", mm::sqlite::column {prefix + std::to_string(i), "a"}},
+            {"b", mm::sqlite::column {i * 2, "b"}}}});
+    return result;
+}
+
+
+std::string value(mm::sqlite::database& db, std::string const& sql_)
+{
+    return db.execute(sql_).at(0).columns().at("v").value();
+}
+
+
+template <typename Function>
+bool throws(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (std::exception const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+
+// rows of every insert statement run on the connection
+struct trace
+{
+    std::vector<std::size_t> rows = {};
+
+    explicit trace(mm::sqlite::database& db)
+    {
+        sqlite3_trace_v2(
+            db.handle(),
+            SQLITE_TRACE_STMT,
+            [](unsigned, void* context, void*, void* sql_) -> int
+            {
+                std::string const text {static_cast<char const*>(sql_)};
+                if (text.rfind("INSERT", 0) == 0)
+                    static_cast<trace*>(context)->rows.push_back(
+                        static_cast<std::size_t>(
+                            std::count(text.begin(), text.end(), '(') - 1));
+                return 0;
+            },
+            this);
+    }
+};
+
+
+// statements stay under the bound parameter limit, the rest of the rows
+// goes through a smaller statement
+void chunking()
+{
+    mm::sqlite::database db {};
+    create(db);
+    trace statements {db};
+
+    mm::sqlite::batch_inserter inserter {db, "t", {"k", "a", "b"}};
+
+    sqlite3_limit(db.handle(), SQLITE_LIMIT_VARIABLE_NUMBER, 10);
+    MM_CHECK(inserter.insert(rows(1, 10)) == 10);
+    MM_CHECK(statements.rows == (std::vector<std::size_t> {3, 3, 3, 1}));
+
+    sqlite3_limit(db.handle(), SQLITE_LIMIT_VARIABLE_NUMBER, 9);
+    statements.rows.clear();
+    MM_CHECK(inserter.insert(rows(11, 6)) == 6);
+    MM_CHECK(statements.rows == (std::vector<std::size_t> {3, 3}));
+
+    // the smaller of the limit and rows_per_statement wins
+    sqlite3_limit(db.handle(), SQLITE_LIMIT_VARIABLE_NUMBER, 32766);
+    inserter.rows_per_statement(4);
+    statements.rows.clear();
+    MM_CHECK(inserter.insert(rows(17, 9)) == 9);
+    MM_CHECK(statements.rows == (std::vector<std::size_t> {4, 4, 1}));
+
+    MM_CHECK(value(db, "SELECT count(*) AS v FROM t") == "25");
+    MM_CHECK(value(db, "SELECT sum(k) AS v FROM t") == "325");
+    MM_CHECK(value(db, "SELECT a || ' ' || b AS v FROM t WHERE k = 25") ==
+             "a25 50");
+
+    sqlite3_limit(db.handle(), SQLITE_LIMIT_VARIABLE_NUMBER, 2);
+    MM_CHECK(throws([&inserter]() { inserter.insert(rows(30, 1)); }));
+    MM_CHECK(throws([&inserter]() { inserter.rows_per_statement(0); }));
+}
+
+
+// a failing row rolls the whole call back, missing columns are NULL
+void rows_and_failures()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    mm::sqlite::batch_inserter inserter {db, "t", {"k", "a", "b"}};
+    inserter.rows_per_statement(3);
+
+    auto batch = rows(1, 8);
+    batch.at(6) = mm::sqlite::row {"k", mm::sqlite::column {7, "k"}};
+    MM_CHECK(throws([&]() { inserter.insert(batch); }));
+    MM_CHECK(value(db, "SELECT count(*) AS v FROM t") == "0");
+
+    batch.at(6) = mm::sqlite::row {columns {
+        {"k", mm::sqlite::column {7, "k"}},
+        {"a", mm::sqlite::column {"x", "a"}}}};
+    MM_CHECK(inserter.insert(batch) == 8);
+    MM_CHECK(value(db, "SELECT quote(b) AS v FROM t WHERE k = 7") == "NULL");
+
+    // an open transaction is joined, not committed
+    db.execute("BEGIN");
+    MM_CHECK(inserter.insert(rows(9, 2)) == 2);
+    db.execute("ROLLBACK");
+    MM_CHECK(value(db, "SELECT count(*) AS v FROM t") == "8");
+}
+
+
+void upserts()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    mm::sqlite::batch_inserter inserter {db, "t", {"k", "a", "b"}};
+    MM_CHECK(inserter.insert(rows(1, 4)) == 4);
+
+    inserter.upsert({"k"});
+    MM_CHECK(inserter.insert(rows(3, 4)) == 2);
+    MM_CHECK(value(db, "SELECT count(*) AS v FROM t") == "6");
+
+    inserter.upsert({"k"}, {"a"});
+    MM_CHECK(inserter.insert(rows(1, 2, "changed")) == 2);
+    MM_CHECK(value(db, "SELECT a || ' ' || b AS v FROM t WHERE k = 1") ==
+             "changed1 2");
+
+    MM_CHECK(throws([&inserter]() { inserter.upsert({}); }));
+}
+} // namespace
+
+
+int main()
+{
+    chunking();
+    rows_and_failures();
+    upserts();
+
+    return EXIT_SUCCESS;
+}
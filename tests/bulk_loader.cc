@@ -0,0 +1,229 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+
+namespace
+{
+std::string indexes(mm::sqlite::database& db)
+{
+    auto rows = db.execute("SELECT group_concat(name) AS n FROM "
+                           "(SELECT name FROM sqlite_master "
+                           "WHERE type = 'index' ORDER BY name)");
+    return rows.at(0).columns().at("n").value();
+}
+
+
+std::string count(mm::sqlite::database& db)
+{
+    auto rows = db.execute("SELECT count(*) AS c FROM t");
+    return rows.at(0).columns().at("c").value();
+}
+
+
+// rows of t in insertion order, as sql literals
+std::string values(mm::sqlite::database& db)
+{
+    auto rows = db.execute("SELECT group_concat(v, ';') AS v FROM "
+                           "(SELECT quote(a) || ' ' || quote(b) AS v "
+                           "FROM t ORDER BY rowid)");
+    return rows.at(0).columns().at("v").value();
+}
+
+
+// error of loading the contents, empty when they were loaded
+std::string failure(mm::sqlite::bulk_loader& loader,
+                    std::string const&       contents)
+{
+    std::ofstream {"bulk_loader.data", std::ios::binary} << contents;
+
+    std::string error {};
+    try
+    {
+        loader.load("bulk_loader.data");
+    }
+    catch (std::exception const& e)
+    {
+        error = e.what();
+    }
+
+    std::remove("bulk_loader.data");
+    return error;
+}
+
+
+bool load(mm::sqlite::database& db, std::string const& contents)
+{
+    mm::sqlite::bulk_loader loader {db, "t", {"a", "b"}};
+    loader.batch_size(1);
+
+    return failure(loader, contents).empty();
+}
+
+
+// unique indexes stay in place and reject the duplicates while loading
+void keep_unique_indexes()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a TEXT, b TEXT)");
+    db.execute("CREATE UNIQUE INDEX u ON t (a)");
+    db.execute("CREATE INDEX i ON t (b)");
+
+    MM_CHECK(!load(db, "x,1\ny,2\nx,3\n"));
+    MM_CHECK(indexes(db) == "i,u");
+    MM_CHECK(count(db) == "2");
+}
+
+
+// deferred indexes come back after failed and successful loads
+void restore_deferred_indexes()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a TEXT, b TEXT)");
+    db.execute("CREATE INDEX i ON t (a)");
+    db.execute("CREATE INDEX j ON t (b)");
+
+    MM_CHECK(!load(db, "x,1\ny\n"));
+    MM_CHECK(indexes(db) == "i,j");
+
+    MM_CHECK(load(db, "z,1\nw,2\n"));
+    MM_CHECK(indexes(db) == "i,j");
+    MM_CHECK(count(db) == "3");
+}
+
+
+// quoted fields keep delimiters, doubled quotes and line breaks
+void csv_fields()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a TEXT, b TEXT)");
+
+    mm::sqlite::bulk_loader loader {db, "t", {}};
+    loader.header(true);
+
+    MM_CHECK(failure(loader,
+                     "b,a\r\n"
+                     "1,x\r\n"
+                     "\"2,3\",\"say \"\"hi\"\"\"\r\n"
+                     "\"line\nbreak\",\"\"\r\n"
+                     "\n"
+                     ",z")
+                 .empty());
+    MM_CHECK(values(db) == "'x' '1';"
+                           "'say \"hi\"' '2,3';"
+                           "'' 'line\nbreak';"
+                           "'z' ''");
+
+    db.execute("DELETE FROM t");
+
+    mm::sqlite::bulk_loader named {db, "t", {"a", "b"}};
+    named.delimiter(';');
+    named.empty_as_null(true);
+
+    MM_CHECK(failure(named, "u;\"v;w\"\n;x\n").empty());
+    MM_CHECK(values(db) == "'u' 'v;w';NULL 'x'");
+}
+
+
+void csv_malformed()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a TEXT, b TEXT)");
+
+    mm::sqlite::bulk_loader loader {db, "t", {"a", "b"}};
+
+    MM_CHECK(failure(loader, "x,\"open\n") ==
+             "Unterminated quoted csv field.");
+    MM_CHECK(failure(loader, "x,\"y\"z\n") == "Invalid quoted csv field.");
+    MM_CHECK(failure(loader, "x,1\ny,2,3\n") ==
+             "Csv record [2] has 3 fields, expected 2.");
+    MM_CHECK(count(db) == "0");
+}
+
+
+// escapes are decoded, literals and numbers keep their types and nested
+// values are stored as json text
+void ndjson_values()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a, b)");
+
+    mm::sqlite::bulk_loader loader {db, "t", {"a", "b"}};
+    loader.format(mm::sqlite::file_format::NDJSON);
+
+    MM_CHECK(failure(loader,
+                     "{\"a\": \"x\\ny\", \"b\": \"\\\"q\\\" \\\\\"}\n"
+                     "{\"b\": \"\\u00e9\\ud83d\\ude00\", \"a\": \"\\/\"}\r\n"
+                     "{\"a\": 12, \"b\": -1.5e1, \"c\": \"ignored\"}\n"
+                     "\n"
+                     "{\"a\": true, \"b\": false}\n"
+                     "{\"a\": null, \"b\": {\"x\": [1, \"}\"]}}")
+                 .empty());
+    MM_CHECK(values(db) == "'x\ny' '\"q\" \\';"
+                           "'/' '\xc3\xa9\xf0\x9f\x98\x80';"
+                           "12 -15.0;"
+                           "1 0;"
+                           "NULL '{\"x\": [1, \"}\"]}'");
+}
+
+
+void ndjson_malformed()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a, b)");
+
+    mm::sqlite::bulk_loader loader {db, "t", {"a", "b"}};
+    loader.format(mm::sqlite::file_format::NDJSON);
+
+    MM_CHECK(failure(loader, "{\"a\": \"x\\") == "Unterminated JSON string.");
+    MM_CHECK(failure(loader, "{\"a\": \"x") == "Unterminated JSON string.");
+    MM_CHECK(failure(loader, "{\"a\": \"\\q\"}") == "Invalid json escape.");
+    MM_CHECK(failure(loader, "{\"a\": \"\\u00g0\"}") ==
+             "Invalid json unicode escape.");
+    MM_CHECK(failure(loader, "{\"a\": 1}\n[1]\n") ==
+             "Json record [2] is not an object.");
+    MM_CHECK(count(db) == "0");
+}
+} // namespace
+
+
+int main()
+{
+    keep_unique_indexes();
+    restore_deferred_indexes();
+    csv_fields();
+    csv_malformed();
+    ndjson_values();
+    ndjson_malformed();
+
+    return EXIT_SUCCESS;
+}
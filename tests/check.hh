@@ -0,0 +1,38 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// exit code of a test whose feature is not part of the build
+#define MM_SKIP 77
+
+// minimal assertion for the test programs, independent of NDEBUG
+#define MM_CHECK(condition)                                                    \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "     \
+                      << #condition << std::endl;                              \
+            std::exit(EXIT_FAILURE);                                           \
+        }                                                                      \
+    } while (false)
@@ -0,0 +1,126 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <vector>
+#include <utility>
+
+
+namespace
+{
+template <typename Function>
+bool throws(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (std::exception const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+
+// invalid settings are rejected before sqlite is touched
+void invalid_arena()
+{
+    mm::sqlite::configuration config {};
+    config.allocator = mm::sqlite::memory_allocator::ARENA;
+
+    MM_CHECK(throws([&config]() { mm::sqlite::configure(config); }));
+}
+
+
+// sizes are 16 bytes apart up to 128 bytes, four per power of two up to
+// 32 KiB and 8 byte aligned above
+void size_classes()
+{
+    std::vector<std::pair<int, int>> const sizes = {
+        {1, 16},       {16, 16},      {17, 32},      {128, 128},
+        {129, 160},    {160, 160},    {161, 192},    {256, 256},
+        {257, 320},    {1000, 1024},  {1025, 1280},  {24577, 28672},
+        {32768, 32768}, {32769, 32776}, {40000, 40000}};
+
+    for (auto const& v : sizes)
+    {
+        void* pointer = sqlite3_malloc(v.first);
+        MM_CHECK(pointer);
+        MM_CHECK(sqlite3_msize(pointer) ==
+                 static_cast<sqlite3_uint64>(v.second));
+        sqlite3_free(pointer);
+    }
+
+    // growing within the size class keeps the block
+    void* pointer = sqlite3_malloc(129);
+    MM_CHECK(sqlite3_realloc(pointer, 160) == pointer);
+
+    pointer = sqlite3_realloc(pointer, 161);
+    MM_CHECK(sqlite3_msize(pointer) == 192);
+    sqlite3_free(pointer);
+}
+
+
+// connections run on the allocator, sqlite cannot be reconfigured once
+// initialized
+void initialized()
+{
+    {
+        mm::sqlite::database db {":memory:",
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+        db.execute("CREATE TABLE t (a TEXT)");
+        for (int i = 0; i < 100; ++i)
+            db.execute("INSERT INTO t VALUES (hex(randomblob(100)))");
+        MM_CHECK(db.execute("SELECT count(*) AS c FROM t")
+                     .at(0)
+                     .columns()
+                     .at("c")
+                     .value() == "100");
+
+        auto const stats = mm::sqlite::memory_stats();
+        MM_CHECK(stats.memory_used.current > 0);
+        MM_CHECK(stats.memory_used.highwater >= stats.memory_used.current);
+    }
+
+    mm::sqlite::configuration config {};
+    config.memstatus = false;
+    MM_CHECK(throws([&config]() { mm::sqlite::configure(config); }));
+}
+} // namespace
+
+
+int main()
+{
+    invalid_arena();
+
+    mm::sqlite::configuration config {};
+    config.allocator = mm::sqlite::memory_allocator::THREAD_CACHING;
+    config.memstatus = true;
+    mm::sqlite::configure(config);
+
+    size_classes();
+    initialized();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+std::string count(mm::sqlite::database& db, std::string const& sql)
+{
+    auto rows = db.execute("SELECT count(*) AS c FROM " + sql);
+    return rows.at(0).columns().at("c").value();
+}
+
+
+void map_ranges()
+{
+    std::map<int, int> const data {{1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}};
+    std::map<int, int> const none {};
+
+    auto const identity = [](int const& v) { return v; };
+
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.create_container_table("m", data, {{"v", identity}});
+    db.create_container_table("e", none, {{"v", identity}});
+
+    MM_CHECK(count(db, "m WHERE key >= 2 AND key < 4") == "2");
+    MM_CHECK(count(db, "m WHERE key >= 3 AND key <= 3") == "1");
+
+    // inverted ranges, with the lower bound past the last key or not
+    MM_CHECK(count(db, "m WHERE key > 5 AND key < 2") == "0");
+    MM_CHECK(count(db, "m WHERE key > 9 AND key <= 1") == "0");
+    MM_CHECK(count(db, "m WHERE key > 3 AND key < 2") == "0");
+    MM_CHECK(count(db, "m WHERE key > 5") == "0");
+
+    MM_CHECK(count(db, "e WHERE key > 1 AND key < 3") == "0");
+    MM_CHECK(count(db, "e WHERE key = 1") == "0");
+}
+
+
+// equal keys all match, and sqlite is not told the key is unique
+void multimap_equality()
+{
+    std::multimap<int, int> const           data {{1, 10}, {1, 11}, {2, 20}};
+    std::unordered_multimap<int, int> const hashed {{1, 10}, {1, 11}};
+    std::unordered_map<int, int> const      unique {{1, 10}, {2, 20}};
+
+    auto const identity = [](int const& v) { return v; };
+
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.create_container_table("m", data, {{"v", identity}});
+    db.create_container_table("h", hashed, {{"v", identity}});
+    db.create_container_table("u", unique, {{"v", identity}});
+
+    MM_CHECK(count(db, "m WHERE key = 1") == "2");
+    MM_CHECK(count(db, "m WHERE key = 2") == "1");
+    MM_CHECK(count(db, "m WHERE key = 3") == "0");
+    MM_CHECK(count(db, "m WHERE key >= 1 AND key < 2") == "2");
+    MM_CHECK(count(db, "h WHERE key = 1") == "2");
+    MM_CHECK(count(db, "u WHERE key = 1") == "1");
+
+    auto const rows =
+        db.execute("SELECT group_concat(v) AS v FROM "
+                   "(SELECT m.v FROM (SELECT 1 AS k) JOIN m ON m.key = k "
+                   "ORDER BY m.v)");
+    MM_CHECK(rows.at(0).columns().at("v").value() == "10,11");
+}
+
+
+// field getters throwing anything fail the statement, not the process
+void throwing_field()
+{
+    std::vector<int> const data {1, 2};
+
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.create_container_table("s",
+                              data,
+                              {{"v",
+                                [](int const& v)
+                                {
+                                    if (v == 2)
+                                        throw 5;
+                                    return v;
+                                }}});
+
+    MM_CHECK(count(db, "s WHERE rowid = 1 AND v = 1") == "1");
+
+    bool failed = false;
+    try
+    {
+        db.execute("SELECT v FROM s");
+    }
+    catch (std::exception const&)
+    {
+        failed = true;
+    }
+    MM_CHECK(failed);
+    MM_CHECK(std::string {sqlite3_errmsg(db.handle())} == "Unknown exception.");
+}
+
+
+void sequence_ranges()
+{
+    std::vector<int> const data {10, 20, 30};
+    std::vector<int> const none {};
+
+    auto const identity = [](int const& v) { return v; };
+
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.create_container_table("s", data, {{"v", identity}});
+    db.create_container_table("e", none, {{"v", identity}});
+
+    MM_CHECK(count(db, "s WHERE rowid >= 2") == "2");
+    MM_CHECK(count(db, "s WHERE rowid > 2 AND rowid < 2") == "0");
+    MM_CHECK(count(db, "s WHERE rowid > 3 AND rowid < 1") == "0");
+
+    // exclusive bounds at the limits of the rowid range
+    MM_CHECK(count(db, "s WHERE rowid > 9223372036854775807") == "0");
+    MM_CHECK(count(db, "s WHERE rowid < -9223372036854775808") == "0");
+    MM_CHECK(count(db, "s WHERE rowid <= 9223372036854775807") == "3");
+
+    MM_CHECK(count(db, "e WHERE rowid >= 1") == "0");
+    MM_CHECK(count(db, "e") == "0");
+}
+} // namespace
+
+
+int main()
+{
+    map_ranges();
+    multimap_equality();
+    sequence_ranges();
+    throwing_field();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <locale>
+#include <string>
+#include <stdexcept>
+
+
+namespace
+{
+// a global locale with a decimal comma must not leak into the sql
+struct decimal_comma : std::numpunct<char>
+{
+    char do_decimal_point() const override { return ','; }
+};
+
+
+void search_and_rank()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE doc (id INTEGER PRIMARY KEY, title, body)");
+
+    mm::sqlite::fulltext_index index {db, "doc", {"title", "body"}};
+    index.create();
+
+    db.execute("INSERT INTO doc VALUES (1, 'apple pie', 'baked with care')");
+    db.execute("INSERT INTO doc VALUES (2, 'pear tart', 'apple on top')");
+    db.execute("INSERT INTO doc VALUES (3, 'plum cake', 'no fruit named')");
+
+    MM_CHECK(index.count(mm::sqlite::fulltext_index::term("apple")) == 2);
+    MM_CHECK(index.count(mm::sqlite::fulltext_index::prefix("pl")) == 1);
+    MM_CHECK(index.count(mm::sqlite::fulltext_index::near({"apple", "top"},
+                                                          2)) == 1);
+
+    auto const previous = std::locale::global(
+        std::locale {std::locale::classic(), new decimal_comma {}});
+    index.weights({10.5, 0.25});
+    std::locale::global(previous);
+
+    auto const rows = index.search_rows("apple");
+    MM_CHECK(rows.size() == 2);
+    MM_CHECK(rows[0].columns().at("id").value() == "1");
+
+    db.execute("UPDATE doc SET body = 'pear only' WHERE id = 2");
+    db.execute("DELETE FROM doc WHERE id = 1");
+    MM_CHECK(index.count("apple") == 0);
+}
+} // namespace
+
+
+int main()
+{
+    try
+    {
+        mm::sqlite::database db {":memory:",
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+        db.execute("CREATE VIRTUAL TABLE probe USING fts5(a)");
+    }
+    catch (std::exception const&)
+    {
+        return MM_SKIP;
+    }
+
+    search_and_rank();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <optional>
+#include <stdexcept>
+
+
+namespace
+{
+std::string value(mm::sqlite::database& db,
+                  std::string const&    sql,
+                  std::string const&    from = "")
+{
+    auto rows = db.execute("SELECT " + sql + " AS v " + from);
+    return rows.at(0).columns().at("v").value();
+}
+
+
+// the statement fails with the message sqlite took from the exception
+std::string error(mm::sqlite::database& db,
+                  std::string const&    sql,
+                  std::string const&    from = "")
+{
+    try
+    {
+        db.execute("SELECT " + sql + " AS v " + from);
+    }
+    catch (std::exception const&)
+    {
+        return sqlite3_errmsg(db.handle());
+    }
+    return {};
+}
+
+
+struct total
+{
+    long sum = 0;
+
+    void step(long const& v) { sum += v; }
+    long finalize() const { return sum; }
+};
+
+
+struct failing
+{
+    int rows = 0;
+
+    void step(long const& v)
+    {
+        if (v < 0)
+            throw std::runtime_error {"negative"};
+        ++rows;
+    }
+    int finalize() const
+    {
+        if (rows > 2)
+            throw 5;
+        return rows;
+    }
+};
+
+
+void scalar_functions()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+
+    db.create_function(
+        "twice", [](long const& v) { return v * 2; }, SQLITE_DETERMINISTIC);
+    db.create_function("greet",
+                       [](std::string const& v) { return "hi " + v; });
+    db.create_function("maybe",
+                       [](std::optional<long> const& v)
+                       { return v ? std::optional<long> {*v + 1} : v; });
+    db.create_function("fail",
+                       [](long const& v) -> long
+                       {
+                           if (v == 1)
+                               throw std::runtime_error {"failed one"};
+                           if (v == 2)
+                               throw 5;
+                           return v;
+                       });
+
+    MM_CHECK(value(db, "twice(21)") == "42");
+    MM_CHECK(value(db, "greet('you')") == "hi you");
+    MM_CHECK(value(db, "maybe(1)") == "2");
+    MM_CHECK(value(db, "maybe(NULL) IS NULL") == "1");
+    MM_CHECK(value(db, "fail(3)") == "3");
+
+    MM_CHECK(error(db, "fail(1)") == "failed one");
+    MM_CHECK(error(db, "fail(2)") == "Unknown exception.");
+    MM_CHECK(value(db, "fail(4)") == "4");
+}
+
+
+void aggregates()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.create_aggregate<total>("total_of");
+    db.create_aggregate<failing>("failing");
+
+    db.execute("CREATE TABLE t (g INTEGER, v INTEGER)");
+    db.execute("INSERT INTO t VALUES (1, 1), (1, 2), (2, 5)");
+
+    auto const rows = db.execute(
+        "SELECT g, total_of(v) AS s FROM t GROUP BY g ORDER BY g");
+    MM_CHECK(rows.size() == 2);
+    MM_CHECK(rows[0].columns().at("s").value() == "3");
+    MM_CHECK(rows[1].columns().at("s").value() == "5");
+
+    // no rows finalize a fresh copy of the prototype
+    MM_CHECK(value(db, "total_of(v)", "FROM t WHERE v > 9") == "0");
+
+    MM_CHECK(value(db, "failing(v)", "FROM t WHERE g = 1") == "2");
+    MM_CHECK(error(db, "failing(v)", "FROM t") == "Unknown exception.");
+    MM_CHECK(error(db, "failing(-v)", "FROM t") == "negative");
+}
+} // namespace
+
+
+int main()
+{
+    scalar_functions();
+    aggregates();
+
+    return EXIT_SUCCESS;
+}
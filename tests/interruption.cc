@@ -0,0 +1,193 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+
+namespace
+{
+// runs far longer than any of the limits below
+std::string const long_query =
+    "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c "
+    "LIMIT 1000000000) SELECT count(*) AS n FROM c";
+
+
+// kind of the error thrown by the function, empty if none was thrown
+template <typename Function>
+std::string error_of(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (mm::sqlite::timeout_error const&)
+    {
+        return "timeout";
+    }
+    catch (mm::sqlite::interrupt_error const&)
+    {
+        return "interrupt";
+    }
+    catch (mm::sqlite::busy_error const&)
+    {
+        return "busy";
+    }
+    catch (std::exception const&)
+    {
+        return "other";
+    }
+    return "";
+}
+
+
+// a deadline ends a runaway query with a timeout, the connection stays usable
+void deadlines()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+
+    db.timeout(std::chrono::milliseconds {20});
+    MM_CHECK(error_of([&db]() { db.execute(long_query); }) == "timeout");
+    MM_CHECK(db.execute("SELECT 1 AS v").at(0).columns().at("v").value() ==
+             "1");
+
+    auto stmt = db.prepare(long_query);
+    stmt.deadline(std::chrono::steady_clock::now());
+    MM_CHECK(error_of([&stmt]() { stmt.step(); }) == "timeout");
+
+    db.timeout(std::chrono::milliseconds {0});
+    MM_CHECK(db.timeout().count() == 0);
+    MM_CHECK(error_of([&db]() { db.timeout(std::chrono::milliseconds {-1}); })
+             == "other");
+}
+
+
+// cancelling interrupts running and later statements until reset
+void cancellation()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+
+    mm::sqlite::cancellation_token token {};
+    db.cancellation(token);
+
+    std::thread canceller {[token]()
+                           {
+                               std::this_thread::sleep_for(
+                                   std::chrono::milliseconds {20});
+                               token.cancel();
+                           }};
+    MM_CHECK(error_of([&db]() { db.execute(long_query); }) == "interrupt");
+    canceller.join();
+
+    MM_CHECK(token.cancelled());
+    MM_CHECK(error_of([&db]() { db.execute(long_query); }) == "interrupt");
+
+    token.reset();
+    MM_CHECK(error_of([&db]() { db.execute("SELECT 1 AS v"); }).empty());
+}
+
+
+// the delay doubles from the initial delay up to the maximum, jitter keeps
+// it within the upper half
+void backoff()
+{
+    mm::sqlite::busy_policy const plain {std::chrono::milliseconds {100},
+                                         std::chrono::microseconds {100},
+                                         std::chrono::microseconds {700},
+                                         false};
+    MM_CHECK(plain.delay(0).count() == 100);
+    MM_CHECK(plain.delay(1).count() == 200);
+    MM_CHECK(plain.delay(2).count() == 400);
+    MM_CHECK(plain.delay(3).count() == 700);
+    MM_CHECK(plain.delay(30).count() == 700);
+
+    mm::sqlite::busy_policy const jittered {std::chrono::milliseconds {100},
+                                            std::chrono::microseconds {100},
+                                            std::chrono::microseconds {800},
+                                            true};
+    for (int i = 0; i < 100; ++i)
+    {
+        auto const delay = jittered.delay(2).count();
+        MM_CHECK(delay >= 200 && delay <= 400);
+    }
+
+    MM_CHECK(error_of(
+                 []()
+                 {
+                     mm::sqlite::busy_policy {std::chrono::milliseconds {1},
+                                              std::chrono::microseconds {10},
+                                              std::chrono::microseconds {5}};
+                 }) == "other");
+}
+
+
+// a locked database is retried until the busy timeout runs out
+void busy_timeout()
+{
+    std::remove("interruption.db");
+
+    int const flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    mm::sqlite::database owner {"interruption.db", flags};
+    owner.execute("CREATE TABLE t (a INTEGER)");
+
+    mm::sqlite::database waiter {"interruption.db", flags};
+    waiter.busy_timeout(mm::sqlite::busy_policy {
+        std::chrono::milliseconds {50}});
+
+    owner.execute("BEGIN IMMEDIATE");
+
+    auto const started = std::chrono::steady_clock::now();
+    MM_CHECK(error_of([&waiter]()
+                      { waiter.execute("INSERT INTO t VALUES (1)"); }) ==
+             "busy");
+    MM_CHECK(std::chrono::steady_clock::now() - started >=
+             std::chrono::milliseconds {50});
+    MM_CHECK(waiter.busy_retries() > 0);
+
+    owner.execute("COMMIT");
+    MM_CHECK(error_of([&waiter]()
+                      { waiter.execute("INSERT INTO t VALUES (1)"); })
+                 .empty());
+
+    owner.close();
+    waiter.close();
+    std::remove("interruption.db");
+}
+} // namespace
+
+
+int main()
+{
+    deadlines();
+    cancellation();
+    backoff();
+    busy_timeout();
+
+    return EXIT_SUCCESS;
+}
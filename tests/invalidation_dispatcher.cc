@@ -0,0 +1,124 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+
+namespace
+{
+// subscribers run after the commit, and may read what it wrote
+void dispatch_after_commit()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT)");
+
+    mm::sqlite::invalidation_dispatcher dispatcher {db};
+
+    std::vector<sqlite3_int64> seen {};
+    std::string                count {};
+
+    dispatcher.subscribe(
+        "t",
+        [&](std::string const&, std::vector<sqlite3_int64> const& rowids)
+        {
+            MM_CHECK(sqlite3_get_autocommit(db.handle()));
+            seen  = rowids;
+            count = db.execute("SELECT count(*) AS c FROM t")
+                        .at(0)
+                        .columns()
+                        .at("c")
+                        .value();
+        });
+
+    db.execute("BEGIN");
+    db.execute("INSERT INTO t (a, b) VALUES (2, 'x'), (1, 'y')");
+    db.execute("UPDATE t SET b = 'z' WHERE a = 2");
+    MM_CHECK(seen.empty());
+    MM_CHECK(dispatcher.pending() == 3);
+    db.execute("COMMIT");
+
+    MM_CHECK((seen == std::vector<sqlite3_int64> {1, 2}));
+    MM_CHECK(count == "2");
+    MM_CHECK(dispatcher.pending() == 0);
+
+    seen.clear();
+    db.prepare("INSERT INTO t (a, b) VALUES (3, 'w')").step();
+    MM_CHECK((seen == std::vector<sqlite3_int64> {3}));
+
+    seen.clear();
+    db.execute("BEGIN");
+    db.execute("DELETE FROM t WHERE a = 1");
+    db.execute("ROLLBACK");
+    MM_CHECK(seen.empty());
+    MM_CHECK(dispatcher.pending() == 0);
+}
+
+
+// exceptions do not unwind through sqlite, a throwing commit hook rolls back
+void throwing_hooks()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY)");
+
+    db.update_hook(
+        [](mm::sqlite::change_type const&,
+           std::string_view const&,
+           std::string_view const&,
+           sqlite3_int64 const&) { throw std::runtime_error {"update"}; });
+    db.execute("INSERT INTO t VALUES (1)");
+
+    db.commit_hook([]() -> bool { throw std::runtime_error {"commit"}; });
+
+    bool failed = false;
+    try
+    {
+        db.execute("INSERT INTO t VALUES (2)");
+    }
+    catch (std::exception const&)
+    {
+        failed = true;
+    }
+
+    db.commit_hook({});
+
+    MM_CHECK(failed);
+    MM_CHECK(db.execute("SELECT count(*) AS c FROM t")
+                 .at(0)
+                 .columns()
+                 .at("c")
+                 .value() == "1");
+}
+} // namespace
+
+
+int main()
+{
+    dispatch_after_commit();
+    throwing_hooks();
+
+    return EXIT_SUCCESS;
+}
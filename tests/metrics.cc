@@ -0,0 +1,152 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <chrono>
+#include <limits>
+#include <locale>
+#include <string>
+
+
+namespace
+{
+// statements observe the registry, disabling metrics stops the recording
+void disable_while_prepared()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.metrics(true);
+    db.execute("CREATE TABLE t (a INTEGER)");
+    db.execute("INSERT INTO t VALUES (1), (2)");
+
+    auto stmt = db.prepare("SELECT a FROM t");
+    stmt.step();
+    MM_CHECK(stmt.metrics() != nullptr);
+
+    db.metrics(false);
+    stmt.step();
+    stmt.step();
+
+    MM_CHECK(stmt.metrics() == nullptr);
+    MM_CHECK(!stmt.has_row());
+}
+
+
+// bucket bounds are inclusive like the le labels, everything past the last
+// bound is counted in the +Inf bucket
+void bucket_edges()
+{
+    using std::chrono::nanoseconds;
+    using snapshot = mm::sqlite::latency_histogram::snapshot;
+
+    MM_CHECK(snapshot::bound(0) == 1e-6);
+    MM_CHECK(snapshot::bound(1) == 2e-6);
+    MM_CHECK(snapshot::bound(23) == 8.388608);
+    MM_CHECK(snapshot::bound(24) == std::numeric_limits<double>::infinity());
+
+    mm::sqlite::latency_histogram histogram {};
+    for (auto const v : {-5, 0, 999, 1000, 1001, 2000, 2001, 4000})
+        histogram.observe(nanoseconds {v});
+    histogram.observe(nanoseconds {(std::int64_t {1} << 23) * 1000});
+    histogram.observe(nanoseconds {(std::int64_t {1} << 23) * 1000 + 1});
+    histogram.observe(std::chrono::hours {1});
+
+    auto const taken = histogram.take();
+    MM_CHECK(taken.count == 11);
+    MM_CHECK(taken.buckets[0] == 4);
+    MM_CHECK(taken.buckets[1] == 2);
+    MM_CHECK(taken.buckets[2] == 2);
+    MM_CHECK(taken.buckets[3] == 0);
+    MM_CHECK(taken.buckets[23] == 1);
+    MM_CHECK(taken.buckets[24] == 2);
+}
+
+
+struct grouping : std::numpunct<char>
+{
+    char        do_thousands_sep() const override { return '\''; }
+    std::string do_grouping() const override { return "\3"; }
+};
+
+
+// the exposition is cumulative per bucket and ignores the global locale
+void prometheus_text()
+{
+    auto const previous =
+        std::locale::global(std::locale {std::locale::classic(), new grouping});
+
+    mm::sqlite::metrics_registry registry {};
+    for (int i = 0; i < 1234; ++i)
+        registry.count_execute();
+    registry.count_error(SQLITE_CONSTRAINT_UNIQUE);
+    registry.count_error(SQLITE_CONSTRAINT);
+    registry.observe_step(std::chrono::microseconds {1});
+    registry.observe_step(std::chrono::microseconds {3});
+    registry.observe_step(std::chrono::seconds {10});
+
+    auto const text = mm::sqlite::metrics_registry::prometheus(
+        registry.take(), "test");
+
+    auto const has = [&text](std::string const& line)
+    { return text.find("\n" + line + "\n") != std::string::npos; };
+
+    MM_CHECK(has("# TYPE test_executes_total counter"));
+    MM_CHECK(has("test_executes_total 1234"));
+    MM_CHECK(has("test_errors_total{code=\"19\"} 2"));
+    MM_CHECK(has("# TYPE test_step_seconds histogram"));
+    MM_CHECK(has("test_step_seconds_bucket{le=\"1e-06\"} 1"));
+    MM_CHECK(has("test_step_seconds_bucket{le=\"2e-06\"} 1"));
+    MM_CHECK(has("test_step_seconds_bucket{le=\"4e-06\"} 2"));
+    MM_CHECK(has("test_step_seconds_bucket{le=\"8.388608\"} 2"));
+    MM_CHECK(has("test_step_seconds_bucket{le=\"+Inf\"} 3"));
+    MM_CHECK(has("test_step_seconds_sum 10.000004"));
+    MM_CHECK(has("test_step_seconds_count 3"));
+    MM_CHECK(has("test_commit_seconds_count 0"));
+
+    std::locale::global(previous);
+
+    // connections add their own counters to the registry ones
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.metrics(true);
+    db.execute("CREATE TABLE t (a INTEGER)");
+    db.execute("INSERT INTO t VALUES (1), (2)");
+    db.execute("SELECT a FROM t");
+
+    auto const snapshot = db.metrics_snapshot();
+    MM_CHECK(snapshot.executes == 3);
+    MM_CHECK(snapshot.rows == 2);
+    MM_CHECK(snapshot.connection.schema_used > 0);
+    MM_CHECK(db.metrics_text().find("\nmmsqlite_rows_total 2\n") !=
+             std::string::npos);
+}
+} // namespace
+
+
+int main()
+{
+    disable_while_prepared();
+    bucket_edges();
+    prometheus_text();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <vector>
+
+
+namespace
+{
+void create(mm::sqlite::database& db)
+{
+    db.open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.execute("CREATE TABLE t (a INTEGER, b INTEGER)");
+    db.execute("CREATE INDEX i ON t (a)");
+    db.execute("CREATE TABLE u (b INTEGER)");
+    db.execute("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 "
+               "FROM c LIMIT 100) INSERT INTO t SELECT x, x % 10 FROM c");
+    db.execute("INSERT INTO u SELECT a FROM t");
+}
+
+
+template <typename Function>
+bool throws(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (std::exception const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+
+// the plan is a forest following the parent ids of EXPLAIN QUERY PLAN
+void plans()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    auto const search = db.query_plan("SELECT b FROM t WHERE a = 5");
+    MM_CHECK(search.size() == 1);
+    MM_CHECK(search.at(0).detail.rfind("SEARCH t USING INDEX i", 0) == 0);
+    MM_CHECK(search.at(0).children.empty());
+
+    auto const compound =
+        db.query_plan("SELECT a FROM t UNION SELECT b FROM t");
+    MM_CHECK(compound.size() == 1);
+    MM_CHECK(compound.at(0).detail == "COMPOUND QUERY");
+    MM_CHECK(compound.at(0).children.size() == 2);
+
+    auto const& first = compound.at(0).children.at(0);
+    MM_CHECK(first.detail == "LEFT-MOST SUBQUERY");
+    MM_CHECK(first.parent == compound.at(0).id);
+    MM_CHECK(first.children.size() == 1);
+    MM_CHECK(compound.at(0).children.at(1).children.at(0).detail == "SCAN t");
+}
+
+
+// only runs at or above a threshold are reported, once per run
+void watchdog()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    std::vector<mm::sqlite::scan_report> reports {};
+    db.watchdog(mm::sqlite::scan_watchdog {
+        [&reports](mm::sqlite::scan_report const& report)
+        { reports.push_back(report); },
+        50,
+        1});
+
+    db.execute("SELECT a FROM t WHERE a = 5");
+    db.execute("SELECT b FROM t WHERE a < 40");
+    MM_CHECK(reports.empty());
+
+    db.execute("SELECT a FROM t WHERE b = 5");
+    MM_CHECK(reports.size() == 1);
+    MM_CHECK(reports.at(0).fullscan_steps >= 50);
+    MM_CHECK(reports.at(0).autoindex == 0);
+    MM_CHECK(reports.at(0).vm_steps > 0);
+    MM_CHECK(reports.at(0).sql.find("FROM t WHERE b") != std::string::npos);
+
+    db.execute("SELECT t.a FROM t JOIN u ON t.b = u.b");
+    MM_CHECK(reports.size() == 2);
+    MM_CHECK(reports.at(1).autoindex > 0);
+
+    // prepared statements are judged when a run ends
+    auto stmt = db.prepare("SELECT a FROM t WHERE b = 5");
+    stmt.step();
+    MM_CHECK(reports.size() == 2);
+    while (stmt.has_row())
+        stmt.step();
+    MM_CHECK(reports.size() == 3);
+
+    db.watchdog(mm::sqlite::scan_watchdog {
+        [&reports](mm::sqlite::scan_report const& report)
+        { reports.push_back(report); },
+        0,
+        0});
+    db.execute("SELECT t.a FROM t JOIN u ON t.b = u.b");
+    MM_CHECK(reports.size() == 3);
+
+    db.watchdog(std::nullopt);
+    db.execute("SELECT a FROM t WHERE b = 5");
+    MM_CHECK(reports.size() == 3);
+
+    MM_CHECK(throws([]() { mm::sqlite::scan_watchdog {nullptr}; }));
+    MM_CHECK(throws(
+        []() { mm::sqlite::scan_watchdog {[](auto const&) {}, -1}; }));
+}
+} // namespace
+
+
+int main()
+{
+    plans();
+    watchdog();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+
+namespace
+{
+std::string count(mm::sqlite::database& db, std::string const& table = "t")
+{
+    auto rows = db.execute("SELECT count(*) AS c FROM " + table);
+    return rows.at(0).columns().at("c").value();
+}
+
+
+void invalidate_cached_table()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.cache(1 << 20);
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT)");
+    db.execute("INSERT INTO t (b) VALUES ('x')");
+
+    MM_CHECK(count(db) == "1");
+    MM_CHECK(count(db) == "1");
+    MM_CHECK(db.cache_statistics().hits == 1);
+
+    db.execute("INSERT INTO t (b) VALUES ('y')");
+
+    MM_CHECK(db.cache_statistics().invalidations == 1);
+    MM_CHECK(db.cache_statistics().entries == 0);
+    MM_CHECK(count(db) == "2");
+}
+
+
+// the update hook fires neither for the truncate optimization nor for
+// WITHOUT ROWID tables
+void invalidate_without_update_hook()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.cache(1 << 20);
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT)");
+    db.execute("CREATE TABLE w (a TEXT PRIMARY KEY, b TEXT) WITHOUT ROWID");
+    db.execute("INSERT INTO t (b) VALUES ('x')");
+    db.execute("INSERT INTO w (a) VALUES ('x')");
+
+    MM_CHECK(count(db, "t") == "1");
+    db.prepare("DELETE FROM t").step();
+    MM_CHECK(count(db, "t") == "0");
+
+    MM_CHECK(count(db, "w") == "1");
+    db.prepare("DELETE FROM w").step();
+    MM_CHECK(count(db, "w") == "0");
+
+    mm::sqlite::batch_inserter inserter {db, "w", {"a", "b"}};
+    inserter.insert({mm::sqlite::row {"a", mm::sqlite::column {"y"}}});
+    MM_CHECK(count(db, "w") == "1");
+
+    // triggers are reported by the authorizer of the inserting statement
+    db.execute("CREATE TABLE l (a TEXT PRIMARY KEY) WITHOUT ROWID");
+    db.execute("CREATE TRIGGER r AFTER INSERT ON w "
+               "BEGIN INSERT INTO l VALUES (new.a); END");
+    MM_CHECK(count(db, "l") == "0");
+    inserter.insert({mm::sqlite::row {"a", mm::sqlite::column {"z"}}});
+    MM_CHECK(count(db, "l") == "1");
+
+    std::ofstream {"result_cache.csv"} << "v\n";
+    mm::sqlite::bulk_loader loader {db, "w", {"a"}};
+    loader.load("result_cache.csv");
+    std::remove("result_cache.csv");
+    MM_CHECK(count(db, "w") == "3");
+}
+
+
+// schema and attachment changes are neither cached nor left stale
+void invalidate_on_schema_change()
+{
+    mm::sqlite::database db {":memory:",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.cache(1 << 20);
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT)");
+    db.execute("INSERT INTO t (b) VALUES ('x')");
+
+    db.execute("ATTACH ':memory:' AS aux");
+    db.execute("CREATE TABLE aux.u (a INTEGER)");
+    MM_CHECK(count(db, "aux.u") == "0");
+    db.execute("DETACH aux");
+    db.execute("ATTACH ':memory:' AS aux");
+    db.execute("CREATE TABLE aux.u (a INTEGER)");
+    MM_CHECK(count(db, "aux.u") == "0");
+    db.execute("DETACH aux");
+
+    MM_CHECK(count(db) == "1");
+    db.execute("CREATE TEMP TABLE t (a INTEGER)");
+    MM_CHECK(count(db) == "0");
+    db.execute("DROP TABLE temp.t");
+    MM_CHECK(count(db) == "1");
+}
+
+
+void replace_cached_entry()
+{
+    mm::sqlite::result_cache cache {1 << 20};
+    mm::sqlite::row          value {"a", mm::sqlite::column {1}};
+
+    cache.insert("k", {value}, {"t"});
+    cache.insert("k", {value, value}, {"t", "u"});
+
+    MM_CHECK(cache.stats().entries == 1);
+    MM_CHECK(cache.find("k")->size() == 2);
+
+    cache.invalidate("u");
+
+    MM_CHECK(cache.stats().entries == 0);
+    MM_CHECK(!cache.find("k"));
+}
+} // namespace
+
+
+int main()
+{
+    invalidate_cached_table();
+    invalidate_without_update_hook();
+    invalidate_on_schema_change();
+    replace_cached_entry();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdexcept>
+
+
+namespace
+{
+std::string count(mm::sqlite::database& db)
+{
+    auto rows = db.execute("SELECT count(*) AS c FROM t");
+    return rows.at(0).columns().at("c").value();
+}
+
+
+void create(mm::sqlite::database& db, std::string const& path)
+{
+    std::remove(path.c_str());
+    db.open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.execute("CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT)");
+}
+
+
+// changes recorded on one file are applied to another, the target's
+// cache and committed subscribers see them
+void apply_between_files()
+{
+    mm::sqlite::database source {};
+    mm::sqlite::database target {};
+    create(source, "session_source.db");
+    create(target, "session_target.db");
+
+    mm::sqlite::session recorder {source};
+    recorder.attach("t");
+    source.execute("INSERT INTO t (a, b) VALUES (1, 'x'), (2, 'y')");
+    auto const changes = recorder.changeset();
+    MM_CHECK(!recorder.empty());
+
+    target.cache(1 << 20);
+    mm::sqlite::invalidation_dispatcher dispatcher {target};
+
+    std::vector<sqlite3_int64> seen {};
+    dispatcher.subscribe(
+        "t",
+        [&seen](std::string const&, std::vector<sqlite3_int64> const& rowids)
+        { seen = rowids; });
+
+    MM_CHECK(count(target) == "0");
+    mm::sqlite::session::apply(target, changes);
+
+    MM_CHECK((seen == std::vector<sqlite3_int64> {1, 2}));
+    MM_CHECK(dispatcher.pending() == 0);
+    MM_CHECK(count(target) == "2");
+
+    // applying again conflicts, by default the application aborts
+    bool aborted = false;
+    try
+    {
+        mm::sqlite::session::apply(target, changes);
+    }
+    catch (std::exception const&)
+    {
+        aborted = true;
+    }
+    MM_CHECK(aborted);
+
+    int conflicts = 0;
+    mm::sqlite::session::apply(
+        target,
+        changes,
+        [&conflicts](mm::sqlite::conflict_type const& type,
+                     std::string const&               table,
+                     mm::sqlite::change_type const&)
+        {
+            MM_CHECK(type == mm::sqlite::conflict_type::CONFLICT);
+            MM_CHECK(table == "t");
+            ++conflicts;
+            return mm::sqlite::conflict_action::OMIT;
+        });
+    MM_CHECK(conflicts == 2);
+
+    mm::sqlite::session::apply(target, mm::sqlite::session::invert(changes));
+    MM_CHECK(count(target) == "0");
+}
+} // namespace
+
+
+int main()
+{
+    try
+    {
+        mm::sqlite::database db {":memory:",
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+        mm::sqlite::session probe {db};
+    }
+    catch (std::exception const&)
+    {
+        return MM_SKIP;
+    }
+
+    apply_between_files();
+
+    std::remove("session_source.db");
+    std::remove("session_target.db");
+
+    return EXIT_SUCCESS;
+}
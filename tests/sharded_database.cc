@@ -0,0 +1,153 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <vector>
+
+
+namespace
+{
+int const flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+
+std::vector<std::string> const keys = {
+    "alpha", "beta", "gamma", "delta", "epsilon", "zeta"};
+
+
+template <typename Function>
+bool throws(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (std::exception const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+
+std::string values(std::vector<mm::sqlite::row> const& rows)
+{
+    std::string result {};
+    for (auto const& v : rows)
+        result += v.columns().at("k").value() + ",";
+    return result;
+}
+
+
+// the hash router is fnv-1a, the range router splits at its bounds
+void routers()
+{
+    using mm::sqlite::sharded_database;
+
+    MM_CHECK(sharded_database::hash_router("", 3) == 2);
+    MM_CHECK(sharded_database::hash_router("a", 1ull << 32) == 0x8601ec8cull);
+    MM_CHECK(sharded_database::hash_router("delta", 3) == 1);
+
+    auto const range = sharded_database::range_router({"g", "p"});
+    MM_CHECK(range("a", 3) == 0);
+    MM_CHECK(range("g", 3) == 1);
+    MM_CHECK(range("o", 3) == 1);
+    MM_CHECK(range("p", 3) == 2);
+    MM_CHECK(range("z", 2) == 1);
+
+    MM_CHECK(throws([]() { sharded_database::range_router({"p", "g"}); }));
+}
+
+
+// keys are written to their shard only, reads of all shards are gathered
+// in shard order
+void routing()
+{
+    mm::sqlite::sharded_database db {
+        {":memory:", ":memory:", ":memory:"}, flags};
+    MM_CHECK(db.size() == 3);
+
+    MM_CHECK(db.execute_all("CREATE TABLE t (k TEXT)").empty());
+
+    for (auto const& v : keys)
+        db.execute(v,
+                   "INSERT INTO t VALUES (:k)",
+                   mm::sqlite::row {"k", mm::sqlite::column {v, "k"}});
+
+    std::string expected {};
+    for (std::size_t i = 0; i < db.size(); ++i)
+    {
+        auto rows = db.run(i,
+                           [](mm::sqlite::database& shard)
+                           {
+                               return shard.execute(
+                                   "SELECT k FROM t ORDER BY k");
+                           })
+                        .get();
+
+        for (auto const& v : rows)
+            MM_CHECK(db.shard(v.columns().at("k").value()) == i);
+
+        expected += values(rows);
+    }
+
+    MM_CHECK(expected == "alpha,delta,beta,epsilon,gamma,zeta,");
+    MM_CHECK(values(db.execute_all("SELECT k FROM t ORDER BY k")) == expected);
+
+    auto future = db.submit("delta", "SELECT k FROM t");
+    MM_CHECK(values(future.get()) == "delta,");
+}
+
+
+void errors()
+{
+    using mm::sqlite::sharded_database;
+
+    MM_CHECK(throws([]() { sharded_database {{}, flags}; }));
+    MM_CHECK(throws([]() { sharded_database {{":memory:"}, flags, nullptr}; }));
+
+    sharded_database db {{":memory:", ":memory:"},
+                         flags,
+                         [](std::string const& key, std::size_t const&)
+                         { return key.size(); }};
+
+    MM_CHECK(db.shard("a") == 1);
+    MM_CHECK(throws([&db]() { db.shard("ab"); }));
+    MM_CHECK(throws([&db]() { db.run(2, [](mm::sqlite::database&) {}); }));
+
+    // a failing shard fails the gather, the other shards still run
+    db.execute("", "CREATE TABLE t (k TEXT)");
+    MM_CHECK(throws([&db]() { db.execute_all("SELECT k FROM t"); }));
+    MM_CHECK(db.execute("", "SELECT k FROM t").empty());
+}
+} // namespace
+
+
+int main()
+{
+    routers();
+    routing();
+    errors();
+
+    return EXIT_SUCCESS;
+}
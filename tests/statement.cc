@@ -0,0 +1,148 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <string>
+#include <utility>
+
+
+namespace
+{
+void create(mm::sqlite::database& db)
+{
+    db.open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    db.execute("CREATE TABLE t (a INTEGER)");
+    db.execute("INSERT INTO t VALUES (1), (2), (3)");
+}
+
+
+// statements of the connection that are not finalized yet
+int open_statements(mm::sqlite::database const& db)
+{
+    int count = 0;
+    for (auto* stmt = sqlite3_next_stmt(db.handle(), nullptr); stmt;
+         stmt       = sqlite3_next_stmt(db.handle(), stmt))
+        ++count;
+    return count;
+}
+
+
+// message of the error thrown by the function, empty if none was thrown
+template <typename Function>
+std::string error_of(Function&& function)
+{
+    try
+    {
+        function();
+    }
+    catch (std::exception const& e)
+    {
+        return e.what();
+    }
+    return "";
+}
+
+
+std::string value(mm::sqlite::statement const& stmt)
+{
+    return stmt.get_row().columns().at("a").value();
+}
+
+
+// a moved statement continues where the source stopped, the source is
+// left without a statement
+void move()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    auto first = db.prepare("SELECT a FROM t ORDER BY a");
+    first.step();
+    MM_CHECK(value(first) == "1");
+
+    mm::sqlite::statement second {std::move(first)};
+    MM_CHECK(first.handle() == nullptr);
+    MM_CHECK(error_of([&first]() { first.step(); }) ==
+             "Statement is not initialized.");
+
+    second.step();
+    MM_CHECK(value(second) == "2");
+    MM_CHECK(open_statements(db) == 1);
+
+    // assigning finalizes the statement that was replaced
+    auto third = db.prepare("SELECT a FROM t WHERE a > :a",
+                            mm::sqlite::row {"a", mm::sqlite::column {1, "a"}});
+    MM_CHECK(open_statements(db) == 2);
+
+    third = std::move(second);
+    MM_CHECK(open_statements(db) == 1);
+    third.step();
+    MM_CHECK(value(third) == "3");
+    third.step();
+    MM_CHECK(!third.has_row());
+
+    // settings and callbacks move along
+    int committed = 0;
+    db.committed_hook([&committed]() { ++committed; });
+
+    auto insert = db.prepare("INSERT INTO t VALUES (4)");
+    auto moved  = std::move(insert);
+    moved.step();
+    MM_CHECK(committed == 1);
+}
+
+
+// statements outliving their database throw instead of stepping
+void closed_database()
+{
+    mm::sqlite::database db {};
+    create(db);
+
+    auto stmt = db.prepare("SELECT a FROM t ORDER BY a");
+    stmt.step();
+
+    db.close();
+
+    MM_CHECK(stmt.sql() == "SELECT a FROM t ORDER BY a");
+    MM_CHECK(error_of([&stmt]() { stmt.step(); }) ==
+             "Database of the statement is closed.");
+    MM_CHECK(error_of([&stmt]() { stmt.prepare("SELECT 1 AS a"); }) ==
+             "Invalid sqlite database.");
+
+    // the connection closes once its last statement is finalized
+    create(db);
+    auto other = db.prepare("SELECT a FROM t");
+    db.close();
+    other.finalize();
+    MM_CHECK(other.handle() == nullptr);
+}
+} // namespace
+
+
+int main()
+{
+    move();
+    closed_database();
+
+    return EXIT_SUCCESS;
+}
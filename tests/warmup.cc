@@ -0,0 +1,162 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+
+namespace
+{
+void create()
+{
+    std::remove("warmup.db");
+
+    mm::sqlite::database db {"warmup.db",
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE};
+    db.execute("CREATE TABLE t (a INTEGER, b TEXT)");
+    db.execute("CREATE INDEX i ON t (b)");
+    db.execute("CREATE TABLE u (a INTEGER)");
+    db.execute("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 "
+               "FROM c LIMIT 5000) INSERT INTO t SELECT x, hex(randomblob(32)) "
+               "FROM c");
+    db.execute("INSERT INTO u SELECT a FROM t");
+}
+
+
+mm::sqlite::warmup::progress finished(mm::sqlite::database const& db)
+{
+    auto const until =
+        std::chrono::steady_clock::now() + std::chrono::seconds {30};
+
+    auto result = db.warmup_progress();
+    while (!result.finished && std::chrono::steady_clock::now() < until)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds {1});
+        result = db.warmup_progress();
+    }
+    return result;
+}
+
+
+// every table and index is scanned in the background, the file stays
+// readable meanwhile
+void sequential()
+{
+    mm::sqlite::database db {};
+    db.open_readonly("warmup.db", mm::sqlite::warmup_mode::SEQUENTIAL);
+
+    MM_CHECK(db.execute("SELECT count(*) AS c FROM u")
+                 .at(0)
+                 .columns()
+                 .at("c")
+                 .value() == "5000");
+
+    auto const status = finished(db);
+    MM_CHECK(status.finished);
+    MM_CHECK(status.objects == 3);
+    MM_CHECK(status.objects_warmed == 3);
+    MM_CHECK(status.file_bytes > 0);
+    MM_CHECK(status.resident_bytes <= status.file_bytes);
+    MM_CHECK(status.resident_fraction() >= 0.0 &&
+             status.resident_fraction() <= 1.0);
+
+    bool thrown = false;
+    try
+    {
+        db.execute("INSERT INTO u VALUES (1)");
+    }
+    catch (std::runtime_error const&)
+    {
+        thrown = true;
+    }
+    MM_CHECK(thrown);
+}
+
+
+// only the named objects are scanned
+void selected()
+{
+    mm::sqlite::database db {};
+    db.open_readonly("warmup.db", mm::sqlite::warmup_mode::SEQUENTIAL, {"i"});
+
+    auto const status = finished(db);
+    MM_CHECK(status.objects == 1);
+    MM_CHECK(status.objects_warmed == 1);
+
+    mm::sqlite::warmup direct {
+        "warmup.db", mm::sqlite::warmup_mode::SEQUENTIAL, {"t", "missing"}};
+    direct.wait();
+    MM_CHECK(direct.status().finished);
+    MM_CHECK(direct.status().objects == 1);
+}
+
+
+// without a scan the progress is finished at once
+void other_modes()
+{
+    mm::sqlite::database db {};
+    db.open_readonly("warmup.db");
+
+    auto status = db.warmup_progress();
+    MM_CHECK(status.finished);
+    MM_CHECK(status.objects == 0 && status.file_bytes == 0);
+
+    db.close();
+    db.open_readonly("warmup.db", mm::sqlite::warmup_mode::WILLNEED);
+
+    status = db.warmup_progress();
+    MM_CHECK(status.finished);
+    MM_CHECK(status.objects == 0);
+    MM_CHECK(status.file_bytes > 0);
+
+    db.close();
+
+    bool thrown = false;
+    try
+    {
+        db.open_readonly("missing.db", mm::sqlite::warmup_mode::SEQUENTIAL);
+    }
+    catch (std::runtime_error const&)
+    {
+        thrown = true;
+    }
+    MM_CHECK(thrown);
+    MM_CHECK(!db.opened());
+}
+} // namespace
+
+
+int main()
+{
+    create();
+
+    sequential();
+    selected();
+    other_modes();
+
+    std::remove("warmup.db");
+
+    return EXIT_SUCCESS;
+}
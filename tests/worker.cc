@@ -0,0 +1,65 @@
+/*
+ * mmsqlite
+ * Copyright (C) 2022  Maruf Sarker
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <mm/sqlite/sqlite.hh>
+
+#include "check.hh"
+
+#include <atomic>
+#include <stdexcept>
+
+
+namespace
+{
+// a failing task neither stops the thread nor the tasks queued after it
+void failing_tasks()
+{
+    mm::sqlite::worker thread {};
+    std::atomic<int>   done {0};
+
+    thread.submit([]() { throw std::runtime_error {"failed"}; });
+    thread.submit([]() { throw 5; });
+    thread.submit([&done]() { ++done; });
+
+    MM_CHECK(thread.run([]() { return 42; }).get() == 42);
+    MM_CHECK(done == 1);
+
+    bool thrown = false;
+    try
+    {
+        thread.run([]() -> int { throw std::runtime_error {"failed"}; })
+            .get();
+    }
+    catch (std::runtime_error const&)
+    {
+        thrown = true;
+    }
+    MM_CHECK(thrown);
+
+    thread.stop();
+}
+} // namespace
+
+
+int main()
+{
+    failing_tasks();
+
+    return EXIT_SUCCESS;
+}